@@ -84,6 +84,7 @@ anim_cropping_on = True # crops the plot window to just contain the animation
 animation_foci = 'all'
 
 # other options
+gross_move_anticollision = 'adjust' # anticollision mode for the target moves, e.g. 'adjust' or 'plan', to compare their stats files
 n_corrections = 0 # number of correction moves to simulate after each target
 max_correction_move = 0.1/1.414 # mm
 should_profile = False
@@ -281,7 +282,7 @@ for pos_param_id, pos_params in pos_param_sequence.items():
                             results_row[keys[0]] = expected[0]
                             results_row[keys[1]] = expected[1] 
                     results_rows[posid] = results_row
-            anticollision = 'adjust'
+            anticollision = gross_move_anticollision
             if n > 0:
                 for request in requests.values():
                     request['command'] = 'poslocdXdY'
@@ -1,5 +1,7 @@
 """This module generates a set of hashable codes for collision lookup.
 
+Obsolete. See collision_table_generator.py, which generates binary lookup tables.
+
 [These notes are current as of 9/12/2018]
 
 POS-POS CASE
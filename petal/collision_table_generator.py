@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+'''Generates binary collision lookup tables, for pos-pos or pos-fixed collisions.
+The grid is split into chunks, which are classified in parallel by worker processes
+using the compiled collider (see classify_pair_cells and classify_fixed_cells in
+poscollider.pyx), and streamed in order to a memory-mappable output file.
+
+Table sizes grow quickly with resolution. A pos-pos table stores only one of each
+symmetric pair of cells, at 2 bits per cell, so n_d * n_s * (n_s + 1) / 8 bytes,
+where n_s = n_t * n_p. Its phi axes need only cover phi below the collider's Ei_phi
+(see notes in poscollider.pyx), so they default to -30 to 150 deg (-30 to 210
+deg for pos-fixed tables). Then 1 deg theta
+and phi steps are ~0.52 GB per distance step (~4.2 GB for 8 distance steps), and the
+5 deg steps are ~0.8 MB per distance step. Pos-fixed tables are much smaller. The
+size is printed before generation starts, and generation refuses to start if the
+table would exceed max_gb (argue a larger value to override).
+
+Example:
+    python collision_table_generator.py pospos -o pospos_5deg.bin -n 8
+    python collision_table_generator.py pospos -o pospos_1deg.bin --t_step 1 --p_step 1 -n 32
+    python collision_table_generator.py posfixed -o posfixed_1deg.bin --t_step 1 --p_step 1 -n 8
+
+To use the tables, set COLLISION_LOOKUP_TABLE (pos-pos) and COLLISION_FIXED_LOOKUP_TABLE
+(pos-fixed) in the collider settings file.
+'''
+
+import os
+import csv
+import time
+import multiprocessing
+import configobj
+import posconstants as pc
+import poscollider
+
+classifiers = {'pos-pos': poscollider.classify_pair_cells,
+               'pos-fixed': poscollider.classify_fixed_cells}
+
+def nominal_keepouts(configfile=None):
+    """Returns dict of the nominal (general) keepout polygons from a collider
+    settings file, and the nominal R1.
+    """
+    filename = configfile if configfile else pc.default_collider_filename
+    config = configobj.ConfigObj(os.path.join(pc.dirs['collision_settings'], filename), unrepr=True)
+    return {'P': poscollider.PosPoly(config['KEEPOUT_PHI']),
+            'T': poscollider.PosPoly(config['KEEPOUT_THETA']),
+            'PTL': poscollider.PosPoly(config['KEEPOUT_PTL']),
+            'GFA': poscollider.PosPoly(config['KEEPOUT_GFA']),
+            'r1': pc.nominals['LENGTH_R1']['value']}
+
+def nominal_locations(path=pc.positioner_locations_file):
+    """Returns dict with key: device location id, value: nominal flat (x, y) center,
+    for all positioner locations in a petal layout file.
+    """
+    with open(path, newline='') as file:
+        rows = [row for row in csv.DictReader(file) if row['device_type'] == 'POS']
+    return {int(row['device_location_id']): (float(row['FLAT_X']), float(row['FLAT_Y'])) for row in rows}
+
+def make_header(kind, configfile=None, **grid):
+    """Returns the table header for kind 'pos-pos' or 'pos-fixed'. Optional grid
+    arguments are passed along to pair_lookup_header or fixed_lookup_header.
+    """
+    keepouts = nominal_keepouts(configfile)
+    if kind == 'pos-pos':
+        return poscollider.pair_lookup_header(keepouts['P'], keepouts['T'], keepouts['r1'], **grid)
+    return poscollider.fixed_lookup_header(keepouts['P'], keepouts['PTL'], keepouts['GFA'], keepouts['r1'],
+                                           nominal_locations(), **grid)
+
+_worker_header = None
+
+def _init_worker(header):
+    global _worker_header
+    _worker_header = header
+
+def _classify_chunk(bounds):
+    return classifiers[_worker_header['kind']](_worker_header, bounds[0], bounds[1])
+
+def generate(path, header, processes=None, chunk_size=1000000, max_gb=5.0, printfunc=print):
+    """Classifies all cells of the grid defined by header, and writes the table
+    file to path. Work is split into chunks of chunk_size cells (rounded up to a
+    multiple of 4, since pos-pos cells are packed 4 per byte), distributed to
+    processes workers (defaults to the number of cpus). Tables larger than max_gb
+    are refused. Returns the cell counts.
+    """
+    size = poscollider.lookup_table_size(header)
+    n_bytes = poscollider.lookup_table_bytes(header)
+    assert n_bytes <= max_gb * 1e9, f'{header["kind"]} table would be {n_bytes / 1e9:.3f} GB, more than max_gb={max_gb}. ' + \
+                                    'Use coarser grid steps, or argue a larger max_gb.'
+    chunk_size = -(-chunk_size // 4) * 4
+    chunks = [(start, min(start + chunk_size, size)) for start in range(0, size, chunk_size)]
+    processes = processes if processes else os.cpu_count()
+    printfunc(f'Generating {header["kind"]} table {path}: {size} cells ({n_bytes / 1e9:.3f} GB), ' +
+              f'{len(chunks)} chunks, {processes} processes')
+    start_time = time.time()
+    tmp_path = path + '.tmp'
+    with open(tmp_path, 'wb') as file:
+        file.write(poscollider.lookup_file_prefix(header))
+        with multiprocessing.Pool(processes, initializer=_init_worker, initargs=(header,)) as pool:
+            for i, cells in enumerate(pool.imap(_classify_chunk, chunks), start=1):
+                file.write(cells)
+                if i % max(1, len(chunks) // 20) == 0 or i == len(chunks):
+                    elapsed = time.time() - start_time
+                    printfunc(f'  {i}/{len(chunks)} chunks, {elapsed:.0f} s elapsed, ' +
+                              f'~{elapsed / i * (len(chunks) - i):.0f} s remaining')
+    os.replace(tmp_path, path)
+    if header['kind'] == 'pos-pos':
+        counts = poscollider.load_pair_lookup(path).counts()
+    else:
+        counts = poscollider.load_fixed_lookup(path).counts()
+    printfunc(f'Wrote {path} in {time.time() - start_time:.1f} s, cells: {counts}')
+    return counts
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('kind', type=str, choices=['pospos', 'posfixed'], help='type of table to generate')
+    parser.add_argument('-o', '--outfile', type=str, required=True, help='path to output table file')
+    parser.add_argument('-n', '--processes', type=int, default=None, help='number of worker processes, defaults to number of cpus')
+    parser.add_argument('-c', '--configfile', type=str, default=None, help='collider settings file with the nominal keepouts, defaults to pc.default_collider_filename')
+    parser.add_argument('--chunk_size', type=int, default=1000000, help='number of cells per unit of work sent to a process')
+    parser.add_argument('--max_gb', type=float, default=5.0, help='refuse to generate a table larger than this (GB)')
+    parser.add_argument('--t_step', type=float, default=5.0, help='theta grid step (deg), must evenly divide 180')
+    parser.add_argument('--p_step', type=float, default=5.0, help='phi grid step (deg)')
+    parser.add_argument('--p_min', type=float, default=-30.0, help='phi at start of grid (deg)')
+    parser.add_argument('--p_max', type=float, default=None, help='phi at end of grid (deg), defaults to 150 for pospos (see notes on Ei_phi in poscollider.pyx) and 210 for posfixed')
+    parser.add_argument('--d_min', type=float, default=10.0, help='(pospos only) center-to-center distance at start of grid (mm)')
+    parser.add_argument('--d_step', type=float, default=0.1, help='(pospos only) center-to-center distance grid step (mm)')
+    parser.add_argument('--n_d', type=int, default=8, help='(pospos only) number of center-to-center distance steps')
+    parser.add_argument('--geometry_slack', type=float, default=0.5, help='max deviation (mm) of actual positioner geometry from nominal, for which table results remain valid')
+    uargs = parser.parse_args()
+    p_max = uargs.p_max if uargs.p_max is not None else {'pospos': 150.0, 'posfixed': 210.0}[uargs.kind]
+    grid = {'t_step': uargs.t_step, 'p_step': uargs.p_step, 'p_min': uargs.p_min,
+            'n_p': int(round((p_max - uargs.p_min) / uargs.p_step)),
+            'geometry_slack': uargs.geometry_slack}
+    if uargs.kind == 'pospos':
+        grid.update({'d_min': uargs.d_min, 'd_step': uargs.d_step, 'n_d': uargs.n_d})
+    kind = {'pospos': 'pos-pos', 'posfixed': 'pos-fixed'}[uargs.kind]
+    header = make_header(kind, configfile=uargs.configfile, **grid)
+    generate(uargs.outfile, header, processes=uargs.processes, chunk_size=uargs.chunk_size, max_gb=uargs.max_gb)
@@ -16,6 +16,7 @@ except Exception as e:
 import posconstants as pc
 import posschedstats
 from petaltransforms import PetalTransforms
+from posbatchtransforms import PosBatchTransforms
 import time
 import os
 import random
@@ -91,7 +92,8 @@ class Petal(object):
         petal_loc       ... integer, (option) location (0-9) of petal in FPA
         phi_limit_on    ... boolean, for experts only, controls whether to enable/disable a safety limit on maximum radius
         sync_mode       ... string, 'hard' --> hardware sync line, 'soft' --> CAN sync signal to start positioners
-        anneal_mode     ... string, 'filled' --> more time-efficient, 'ramped' --> slower total power ramp-up
+        anneal_mode     ... string, 'filled' --> more time-efficient, 'ramped' --> slower total power ramp-up,
+                            'packed' --> shortest time within a cap on concurrent motors per power supply
 
     Note that if petal.py is used within PetalApp.py, the code has direct access to variables defined in PetalApp. For example self.anticol_settings
     Eventually we could clean up the constructure (__init__) and pass viewer arguments.
@@ -207,6 +209,7 @@ class Petal(object):
 
         # schedule settings
         self.anneal_mode = anneal_mode
+        self.schedule_cache = posschedule.ScheduleCache(size=0) # disabled by default, see set_schedule_cache_size()
 
         # must call the following 3 methods whenever petal alingment changes
         self.init_ptltrans()
@@ -381,6 +384,7 @@ class Petal(object):
         self.canids_to_posids = {canid:posid for posid,canid in self.canids.items()}
         self.buscan_to_posids = {(self.busids[posid], self.canids[posid]): posid for posid in self.posids}
         self.power_supply_map = self._map_power_supplies_to_posids()  # used by posschedulestage for annealing
+        self.batch_trans = PosBatchTransforms(self.posmodels, petal_alignment=self.alignment)  # petal-wide coordinate conversions, see transform() and quick_table()
         if hasattr(self, 'index'):
             etcs = self.index.find_by_arbitrary_keys(DEVICE_TYPE='ETC', PETAL_ID=self.petal_id, key='DEVICE_ID')
             self.etcs = set(etcs) & self.posids
@@ -739,7 +743,7 @@ class Petal(object):
                 self.request_direct_dtdp(request, cmd_prefix='debounce', should_time=False)
         self._stop_request_timer()
 
-    def schedule_moves(self, anticollision='default', should_anneal=True):
+    def schedule_moves(self, anticollision='default', should_anneal=True, deadline=None):
         """Generate the schedule of moves and submoves that get positioners
         from start to target. Call this after having input all desired moves
         using the move request methods.
@@ -751,11 +755,16 @@ class Petal(object):
         to be spread out in time to reduce peak current draw by the full array
         of positioners. (But there are certain 'expert use' test cases in the
         lab, where we want this feature turned off.)
+
+        The optional deadline is a time budget in seconds for the scheduling
+        calculation. See posschedule.py for behavior when it is exceeded.
         """
         if anticollision == 'None':
             anticollision = None  # because DOS Console casts None into 'None'
+        if deadline == 'None':
+            deadline = None
         self.printfunc(f'schedule_moves called with anticollision = {anticollision}')
-        if anticollision not in {None, 'freeze', 'adjust', 'adjust_requested_only'}:
+        if anticollision not in {None, 'freeze', 'adjust', 'adjust_requested_only', 'plan'}:
             anticollision = self.anticollision_default
             self.printfunc(f'using default anticollision mode --> {self.anticollision_default}')
 
@@ -766,8 +775,9 @@ class Petal(object):
         # arguments directly from one to the next.
         self.__current_schedule_moves_anticollision = anticollision
         self.__current_schedule_moves_should_anneal = should_anneal
+        self.__current_schedule_moves_deadline = deadline
 
-        self.schedule.schedule_moves(anticollision, should_anneal)
+        self.schedule.schedule_moves(anticollision, should_anneal, deadline)
 
     def send_move_tables(self, n_retries=1, previous_failed=None):
         """Send move tables that have been scheduled out to the positioners.
@@ -921,7 +931,7 @@ class Petal(object):
                     cmd       ... command string like those usually put in the requests dictionary (see valid options below)
                     target    ... [u,v] values, note that all positioners here get sent the same [u,v] here
                     log_note  ... optional string to include in the log file
-                    anticollsion  ... 'default', 'adjust', 'adjust_requested_only', 'freeze', or None. See comments in schedule_moves() function
+                    anticollsion  ... 'default', 'adjust', 'adjust_requested_only', 'plan', 'freeze', or None. See comments in schedule_moves() function
                     should_anneal ... boolean, see comments in schedule_moves() function
                     disable_limit_angle ... boolean, when True will turn off any phi limit angle
 
@@ -976,7 +986,7 @@ class Petal(object):
                     n_repeats ... integer number of repeats of the sequence, defaults to 1
                     delay ... minimum seconds from move to move, defaults to 60
                     targets ... sequence of tuples giving poslocXY targets, default is [(3,0), (0,1), (-3,0), (0,-1)]
-                    anticollsion  ... 'default', 'adjust', 'adjust_requested_only', 'freeze', or None. See comments in schedule_moves() function
+                    anticollsion  ... 'default', 'adjust', 'adjust_requested_only', 'plan', 'freeze', or None. See comments in schedule_moves() function
                     should_anneal ... see comments in schedule_moves() function, defaults to True
                     disable_limit_angle ... boolean, when True will turn off any phi limit angle, defaults to False
         '''
@@ -1880,7 +1890,11 @@ class Petal(object):
         data = {c:[] for c in columns}
         floats = {c:[] for c in columns}
         fmt_coord = lambda value, coord: format(value, pc.coord_formats[coord])
-        for posid in posids:
+        posids = sorted(posids)
+        self.batch_trans.refresh(posids)
+        posintTP = np.array([self.posmodels[posid].expected_current_posintTP for posid in posids], dtype=float).reshape(-1, 2).T
+        positions = self.batch_trans.expected_positions(posintTP, posids)
+        for j, posid in enumerate(posids):
             model = self.posmodels[posid]
             data['POSID'].append(posid)
             data['LOCID'].append(model.deviceloc)
@@ -1889,11 +1903,10 @@ class Petal(object):
             data['ENABLED'].append(model.is_enabled)
             data['OVERLAP'].append(overlap_strs[posid] if posid in overlap_strs else 'None')
             data['AMBIG_T'].append(model.in_theta_hardstop_ambiguous_zone)
-            pos = self.posmodels[posid].expected_current_position
             for coord in coords:
                 for i in (0, 1):
                     split_name = pc.coord_pair2single[coord][i]
-                    value = pos[coord][i]
+                    value = float(positions[coord][i, j])
                     if not as_table:
                         floats[split_name].append(value)
                         value = fmt_coord(value, split_name)
@@ -2502,7 +2515,8 @@ class Petal(object):
                 else:
                     anticollision = self.__current_schedule_moves_anticollision
                 should_anneal = self.__current_schedule_moves_should_anneal
-                self.schedule_moves(anticollision=anticollision, should_anneal=should_anneal)
+                deadline = self.__current_schedule_moves_deadline
+                self.schedule_moves(anticollision=anticollision, should_anneal=should_anneal, deadline=deadline)
                 return self.send_move_tables(n_retries - 1, previous_failed=all_failed_send)
             else:
                 msg = 'WARNING: Due to failures when sending move tables to positioners, the entire move is canceled.'
@@ -2786,11 +2800,24 @@ class Petal(object):
 
         OUTPUT:  same as coord, but now with 'uv2' field added
                  order of coord *will* be preserved
+
+        All positioners are converted together by self.batch_trans, with results
+        equal to those of their individual PosTransforms.construct() functions.
         '''
-        for d in coord:
-            trans = self.posmodels[d['posid']].trans
-            func = trans.construct(coord_in=cs1, coord_out=cs2)
-            d['uv2'] = func(d['uv1'])
+        if not coord:
+            return coord
+        posids = [d['posid'] for d in coord]
+        self.batch_trans.refresh(set(posids))
+        func = self.batch_trans.construct(coord_in=cs1, coord_out=cs2)
+        uv1 = np.array([d['uv1'] for d in coord], dtype=float).T
+        uv2 = func(uv1, posids)
+        if isinstance(uv2, tuple):  # conversions to posintTP or poslocTP, with "unreachable" flags
+            uv2, unreachable = uv2
+            for i, d in enumerate(coord):
+                d['uv2'] = ((float(uv2[0, i]), float(uv2[1, i])), bool(unreachable[i]))
+        else:
+            for i, d in enumerate(coord):
+                d['uv2'] = (float(uv2[0, i]), float(uv2[1, i]))
         return coord
 
     def set_anneal_params(self, density=None, mode='filled'):
@@ -2808,6 +2835,8 @@ class Petal(object):
 
                  mode ... str, 'filled' --> try to most efficiently fill time with moves
                                'ramped' --> try to ramp up/down the power (takes more time)
+                               'packed' --> minimize time, with no more motors concurrently running on
+                                            each power supply than 'filled' would have at that density
 
         OUTPUTS:  reply string, stating what was done
 
@@ -2839,6 +2868,35 @@ class Petal(object):
         '''
         return {self.anneal_mode: pc.anneal_density[self.anneal_mode]}
 
+    def set_schedule_cache_size(self, size=0):
+        '''Set max number of schedules kept in the schedule cache. When enabled,
+        repeating the same set of requests from the same starting positions (with
+        unchanged calibrations and settings) reuses the previously computed move
+        tables, after a verifying collision check. Setting size=0 disables the
+        cache and clears it.
+
+        This setting is in memory only. It reverts to disabled upon re-initialization.
+
+        INPUTS:  size ... int >= 0
+
+        OUTPUTS:  reply string, stating what was done
+        '''
+        if not pc.is_integer(size) or size < 0:
+            reply = f'FAILED: Invalid schedule cache size "{size}", must be an integer >= 0'
+        else:
+            self.schedule_cache.size = int(size)
+            if size == 0:
+                self.schedule_cache.clear()
+            reply = f'SUCCESS: Set schedule cache size to {size}'
+        self.printfunc(reply)
+        return reply
+
+    def get_schedule_cache_info(self):
+        '''Returns dict stating the schedule cache size, number of entries, and
+        hit / miss / rejected counts.
+        '''
+        return self.schedule_cache.get_info()
+
     def get_clear_phi(self):
         '''Returns list of posids on this petal for which the phi axes currently have
         clear paths for full extension. In other words, any combination of these positioners
@@ -1,4 +1,6 @@
 import numpy as np
+import math
+import collections
 import posconstants as pc
 
 
@@ -136,39 +138,93 @@ class PetalTransforms:
         if cast:
             QST = typecast(QST)
         Q_rad, S, T = np.radians(QST[0, :]), QST[1, :], QST[2, :]
-        R = pc.S2R_lookup(S) + T * np.sin(np.radians(pc.S2N_lookup(S)))
-        Z = pc.S2Z_lookup(S) + T * np.cos(np.radians(pc.S2N_lookup(S)))
+        N_rad = np.radians(pc.S2N_lookup(S))
+        R = pc.S2R_lookup(S) + T * np.sin(N_rad)
+        Z = pc.S2Z_lookup(S) + T * np.cos(N_rad)
         X, Y = R * np.cos(Q_rad), R * np.sin(Q_rad)
         return np.vstack([X, Y, Z])  # 3 x N array
 
     @staticmethod
-    def obsXYZ_to_QST(obsXYZ, cast=False, max_iter=10, tol=1e-6):
+    def obsXYZ_to_QST(obsXYZ, cast=False, max_iter=10, tol=1e-6, iteration_counts=None):
         """Transform obsXYZ coordinates into QST system, tol of dtheta in deg
         INPUT:  3 x N array, each column vector is obsXYZ
         OUTPUT: 3 x N array, each column vector is QST
+
+        Nutation N is solved per point by Newton's method on
+            f(N) = S2N(S0 - dZ * sin(N)) - N
+        where S0 and dZ are the on-shell S and the Z offset at the point's R.
+        Each point stops updating once its own step is below tol. Optionally
+        argue a collections.Counter as iteration_counts, to which the number
+        of iterations used per point is added (keys = iterations, values =
+        number of points).
         """
         if cast:
             obsXYZ = typecast(obsXYZ)
         X, Y, Z = obsXYZ[0, :], obsXYZ[1, :], obsXYZ[2, :]
         Q = np.degrees(np.arctan2(Y, X))  # Y over X, azimuthal angle in deg
         R = np.sqrt(np.square(X) + np.square(Y))
-        # iteratively find S, use nutation which is the fastest changing coord
-        N0 = pc.R2N_lookup(R)  # get nutation angle in the ballpark
+        if R.size == 1:  # per-positioner calls, skip the array overhead
+            S, T, iterations = PetalTransforms._R_Z_to_ST(float(R[0]), float(Z[0]), max_iter, tol)
+            if iteration_counts is not None:
+                iteration_counts[iterations] += 1
+            return np.array([Q, [S], [T]])
+        N = pc.R2N_lookup(R)  # get nutation angle in the ballpark
+        S0, dZ = pc.R2S_lookup(R), Z - pc.R2Z_lookup(R)
+        S = np.full(N.shape, np.nan)  # off-table points stay nan
+        iterations = np.zeros(N.shape, dtype=int)
+        solvable = np.isfinite(N + dZ)
+        idx = slice(None) if solvable.all() else np.flatnonzero(solvable)
+        N_act, S0_act, dZ_act = N[idx], S0[idx], dZ[idx]
+        n_iter = np.zeros(N_act.size, dtype=int)
+        converged = np.zeros(N_act.size, dtype=bool)  # masked out of further updates
         for i in range(max_iter):
-            # print(f'iter {i}, starting with N0 = {N0}')  # debug
-            S = (pc.R2S_lookup(R)  # S correction with nutation angle
-                 - (Z - pc.R2Z_lookup(R)) * np.sin(np.radians(N0)))
-            N1 = pc.S2N_lookup(S)  # update nutation with better S
-            diff = N1 - N0
-            # print(f'diff = {diff}')  # debug
-            if np.all(np.abs(diff) < tol):  # deg
-                break  # now we have S that satisfies the equality sufficiently
-            else:
-                N0 = N1
+            sin_N = np.sin(np.radians(N_act))
+            cos_N = np.sqrt(1.0 - sin_N * sin_N)  # nutation is always well within +/-90 deg
+            S_act = S0_act - dZ_act * sin_N  # S correction with nutation angle
+            S2N, dS2N_dS = pc.S2N_lookup_with_slope(S_act)
+            step = (S2N - N_act) / (1.0 + dS2N_dS * dZ_act * cos_N * (np.pi / 180))
+            n_iter += ~converged
+            converged |= np.abs(step) < tol  # deg
+            step[converged] = 0.0  # so S_act and S2N stay as they were at convergence
+            N_act = N_act + step
+            n_converged = np.count_nonzero(converged)
+            if n_converged == N_act.size or i == max_iter - 1:
+                S[idx], N[idx], iterations[idx] = S_act, S2N, n_iter
+                break
+            if n_converged > N_act.size // 2:  # compact the remaining points
+                idx = np.arange(N.size)[idx]
+                done = converged
+                S[idx[done]], N[idx[done]], iterations[idx[done]] = S_act[done], S2N[done], n_iter[done]
+                keep = ~done
+                idx, N_act, S0_act, dZ_act, n_iter = idx[keep], N_act[keep], S0_act[keep], dZ_act[keep], n_iter[keep]
+                converged = converged[keep]
+        if iteration_counts is not None:
+            iteration_counts.update({n: count for n, count in enumerate(np.bincount(iterations).tolist()) if count})
         # use the delta Z equation to calculate T since dZ is bigger than dR
-        T = (Z - pc.S2Z_lookup(S)) / np.cos(np.radians(pc.S2N_lookup(S)))
+        T = (Z - pc.S2Z_lookup(S)) / np.cos(np.radians(N))
         return np.vstack([Q, S, T])  # 3 x N array
 
+    @staticmethod
+    def _R_Z_to_ST(R, Z, max_iter, tol):
+        """Single point version of the Newton iterations in obsXYZ_to_QST(),
+        with identical arithmetic. Returns (S, T, number of iterations).
+        """
+        N = pc.R2N_lookup(R)
+        S0, dZ = pc.R2S_lookup(R), Z - pc.R2Z_lookup(R)
+        if not math.isfinite(N + dZ):
+            return np.nan, np.nan, 0
+        for i in range(max_iter):
+            sin_N = math.sin(math.radians(N))
+            cos_N = math.sqrt(1.0 - sin_N * sin_N)
+            S = S0 - dZ * sin_N
+            S2N, dS2N_dS = pc.S2N_lookup_with_slope(S)
+            step = (S2N - N) / (1.0 + dS2N_dS * dZ * cos_N * (math.pi / 180))
+            if abs(step) < tol:
+                break
+            N = N + step
+        T = (Z - pc.S2Z_lookup(S)) / math.cos(math.radians(S2N))
+        return S, T, i + 1
+
     # %% QS transforms in 2D as projected from QST onto the focal surface
 
     @staticmethod
@@ -475,12 +531,13 @@ if __name__ == '__main__':
     # print(f'obsXYZ, actual: {obsXYZ_actual.T}\ntransformed: {obsXYZ.T}\n'
     #       f'ptlXYZ, actual: {ptlXYZ_actual.T}\ntransformed: {ptlXYZ.T}')
     trans = PetalTransforms(gamma=0/180*np.pi)
+    QST_iterations = collections.Counter()
     # location 408
     ptlXYZ = np.array([346.797988, 194.710169, -17.737838]).reshape(3, 1)
     QST = np.array([29.312088, 398.257190, -0.2]).reshape(3, 1)  # 200 microns
     obsXYZ = trans.QST_to_obsXYZ(QST)
     print(f'obsXYZ = {obsXYZ.T}')
-    QST = trans.obsXYZ_to_QST(obsXYZ)
+    QST = trans.obsXYZ_to_QST(obsXYZ, iteration_counts=QST_iterations)
     print(f'QST = {QST.T}')
     QS = trans.obsXYZ_to_QS(obsXYZ)
     print(f'QS = {QS.T}')
@@ -532,7 +589,7 @@ if __name__ == '__main__':
     # additional QST tests
     obsXYZ = np.array([295.3328802, 207.2633873, -14.737207]).reshape(3, 1)
     print(f'Fitted obsXYZ = {obsXYZ.T}')
-    QST = trans.obsXYZ_to_QST(obsXYZ)
+    QST = trans.obsXYZ_to_QST(obsXYZ, iteration_counts=QST_iterations)
     print(f'QST = {QST.T}')
     obsXYZ = trans.QST_to_obsXYZ(QST)
     print(f'obsXYZ = {obsXYZ.T}')
@@ -540,7 +597,7 @@ if __name__ == '__main__':
     # device_loc 541, fid
     obsXYZ = np.array([295.332581765, 207.26336747500002, -14.743447455]).reshape(3, 1)
     print(f'CMM obsXYZ = {obsXYZ.T}')
-    QST = trans.obsXYZ_to_QST(obsXYZ)
+    QST = trans.obsXYZ_to_QST(obsXYZ, iteration_counts=QST_iterations)
     print(f'QST = {QST.T}')
     obsXYZ = trans.QST_to_obsXYZ(QST)
     print(f'obsXYZ = {obsXYZ.T}')
@@ -552,6 +609,10 @@ if __name__ == '__main__':
     flatXY = trans._QS_to_flatXY(QS)
     print(f'flatXY = {flatXY.T}')
     
+    # focal surface lookups vs chained np.interp of the lookup table
+    print(pc.focal_surface_lookup_report())
+    print(f'obsXYZ_to_QST iterations histogram: {dict(sorted(QST_iterations.items()))}')
+
     # QS obsXY consistency check
     ptlXYZ = np.array([346.797988, 194.710169, -17.737838]).reshape(3, 1)
     QS = trans.ptlXYZ_to_QS(ptlXYZ)
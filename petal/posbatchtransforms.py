@@ -0,0 +1,284 @@
+import numpy as np
+import posconstants as pc
+import petaltransforms
+import postransforms
+import xy2tp
+
+class PosBatchTransforms(petaltransforms.PetalTransforms):
+    """Petal-wide, array-based counterpart of PosTransforms.
+
+    Where PosTransforms converts the coordinates of one positioner at a time,
+    this class converts many positioners at once. The calibration values
+    LENGTH_R1, LENGTH_R2, OFFSET_T, OFFSET_P, OFFSET_X, OFFSET_Y, and the
+    'full' and 'targetable' range limits, are held for all positioners as numpy
+    arrays. Transformations follow exactly the same sequence of steps as their
+    PosTransforms equivalents, so the results agree to numeric precision.
+
+    Method names and coordinate systems are the same as in PosTransforms. Inputs
+    are 2 x N arrays, each column vector a coordinate pair, as in PetalTransforms.
+    Each method also takes posids, a sequence of N posids giving the positioner
+    for each column. If posids is None, the columns are for all positioners, in
+    the order of self.posids. Outputs are 2 x N arrays. Methods returning posintTP
+    or poslocTP from an XY-type input return a tuple (2 x N array, N-element
+    boolean array of "unreachable" flags), just as PosTransforms does for single
+    values. Their t_guess argument is either None or an N-element array (nan
+    meaning no guess for that positioner).
+
+    The calibration arrays are loaded from the posmodels at initialization.
+    Call refresh() before a batch of transformations, to reload any positioners
+    whose state has changed since (as tracked by PosState.revision), or whose
+    PosTransforms alt_override flag or alt values have changed. Values written
+    directly into PosState._val, bypassing PosState.store(), do not bump the
+    revision and so are not detected. Call refresh(force=True) after doing that.
+
+    INITIALIZATION ARGUMENTS:
+    -------------------------
+        posmodels ... dict with keys = posids, values = PosModel instances
+
+        petal_alignment [optional]
+            Dictionary of six values defining the petal's rigid-body position
+            in the focal plane. See parent module PetalTransforms.
+    """
+
+    calib_keys = ['LENGTH_R1', 'LENGTH_R2', 'OFFSET_T', 'OFFSET_P', 'OFFSET_X', 'OFFSET_Y']
+
+    def __init__(self, posmodels, petal_alignment=None):
+        if petal_alignment is None:
+            petal_alignment = {'Tx': 0, 'Ty': 0, 'Tz': 0,
+                               'alpha': 0, 'beta': 0, 'gamma': 0}
+        super().__init__(Tx=petal_alignment['Tx'],
+                         Ty=petal_alignment['Ty'],
+                         Tz=petal_alignment['Tz'],
+                         alpha=petal_alignment['alpha'],
+                         beta=petal_alignment['beta'],
+                         gamma=petal_alignment['gamma'], curved=True)
+        self.posmodels = posmodels
+        self.posids = sorted(posmodels)
+        self.index = {posid: i for i, posid in enumerate(self.posids)}  # column of each posid in the calibration arrays
+        n = len(self.posids)
+        self.calib = {key: np.zeros(n) for key in self.calib_keys}
+        self.ranges = {'full': np.zeros((n, 2, 2)),  # indices: [positioner, axis (T or P), min or max]
+                       'targetable': np.zeros((n, 2, 2))}
+        self._loaded_keys = [None] * n  # staleness key of each positioner, as of its latest load (see _staleness_key)
+        self.refresh()
+
+    def refresh(self, posids=None, force=False):
+        """Reloads calibration values and range limits, for any of the argued
+        posids (default all) whose state has been altered since last loaded. The
+        argument force=True reloads them regardless. Returns the set of posids
+        that were reloaded.
+        """
+        posids = self.posids if posids is None else posids
+        reloaded = set()
+        for posid in posids:
+            i = self.index[posid]
+            posmodel = self.posmodels[posid]
+            staleness_key = self._staleness_key(posmodel)
+            if staleness_key == self._loaded_keys[i] and not force:
+                continue
+            for key in self.calib_keys:
+                self.calib[key][i] = posmodel.trans.getval(key)
+            self.ranges['full'][i] = [posmodel.full_range_posintT, posmodel.full_range_posintP]
+            self.ranges['targetable'][i] = [posmodel.targetable_range_posintT, posmodel.targetable_range_posintP]
+            self._loaded_keys[i] = staleness_key
+            reloaded.add(posid)
+        return reloaded
+
+    def _staleness_key(self, posmodel):
+        """Returns a value which changes whenever the calibration values seen through
+        posmodel.trans.getval() may have. That is the state revision, plus the alt
+        values when PosTransforms.alt_override is on (since getval then reads those
+        instead of the state).
+        """
+        trans = posmodel.trans
+        if trans.alt_override:
+            return (posmodel.state.revision, tuple(trans.alt[key] for key in self.calib_keys))
+        return (posmodel.state.revision, None)
+
+    def construct(self, coord_in, coord_out):
+        '''Utility to construct a batch transform function using strings describing
+        the coordinates in and out. The function takes arguments (uv, posids=None),
+        and possibly the further keyword arguments of the named method. Returns None
+        for any combination not supported by PosTransforms.construct().'''
+        need_cast = {'obsXY_to_QS', 'QS_to_obsXY', 'flatXY_to_QS', 'QS_to_flatXY', 'flatXY_to_obsXY', 'obsXY_to_flatXY'}
+        coords = {'posintTP', 'poslocTP', 'poslocXY', 'flatXY', 'obsXY', 'QS', 'ptlXY'}
+        if coord_in not in coords or coord_out not in coords or coord_in == coord_out:
+            return None
+        func_name = f'{coord_in}_to_{coord_out}'
+        if not hasattr(self, func_name):
+            return None
+        handle = getattr(self, func_name)
+        if func_name in need_cast:
+            def handle2(uv, posids=None):
+                return handle(np.asarray(uv, dtype=float))
+            return handle2
+        return handle
+
+    def shaft_ranges(self, range_limits, posids=None):
+        """Returns N x 2 x 2 array of range limits [positioner, axis, min/max]
+        for the argued posids. The argument range_limits is a string, as in
+        PosTransforms.shaft_ranges(), or a numeric [[minT, maxT], [minP, maxP]].
+        """
+        rows = self._rows(posids)
+        n = len(self.posids) if posids is None else len(posids)
+        if isinstance(range_limits, (list, tuple)):
+            return np.broadcast_to(np.array(range_limits, dtype=float), (n, 2, 2))
+        if range_limits == 'exact':
+            return np.broadcast_to(np.array(postransforms.PosTransforms.exact_range_limits, dtype=float), (n, 2, 2))
+        return self.ranges[range_limits][rows]
+
+    def _rows(self, posids):
+        """Returns index array (or slice) into the calibration arrays, for posids."""
+        if posids is None:
+            return slice(None)
+        return np.array([self.index[posid] for posid in posids], dtype=int)
+
+    def _cal(self, key, posids):
+        """Returns array of calibration values for key, one per posid."""
+        return self.calib[key][self._rows(posids)]
+
+    # LOWEST LEVEL CALIBRATED XY <--> TP CONVERSIONS
+    def poslocTP_to_poslocXY(self, poslocTP, posids=None):
+        t = np.radians(poslocTP[0])
+        t_plus_p = t + np.radians(poslocTP[1])
+        r1, r2 = self._cal('LENGTH_R1', posids), self._cal('LENGTH_R2', posids)
+        x = r1 * np.cos(t) + r2 * np.cos(t_plus_p)
+        y = r1 * np.sin(t) + r2 * np.sin(t_plus_p)
+        return np.vstack([x, y])
+
+    def poslocXY_to_poslocTP(self, poslocXY, posids=None, range_limits='full',
+                             t_guess=None, t_guess_tol=pc.default_t_guess_tol):
+        '''Converts poslocXY to poslocTP. Returns tuple (poslocTP, unreachable).
+        See PosTransforms.poslocXY_to_poslocTP() and the xy2tp module.'''
+        posint_ranges = self.shaft_ranges(range_limits, posids)
+        offsets = np.stack([self._cal('OFFSET_T', posids), self._cal('OFFSET_P', posids)], axis=1)
+        posloc_ranges = posint_ranges + offsets[:, :, np.newaxis]
+        r = np.vstack([self._cal('LENGTH_R1', posids), self._cal('LENGTH_R2', posids)])
+        return xy2tp.xy2tp_batch(poslocXY, r, posloc_ranges, t_guess, t_guess_tol)
+
+    # OFFSET TRANSFORMATIONS
+    def posintTP_to_poslocTP(self, posintTP, posids=None):
+        return np.vstack([posintTP[0] + self._cal('OFFSET_T', posids),
+                          posintTP[1] + self._cal('OFFSET_P', posids)])
+
+    def poslocTP_to_posintTP(self, poslocTP, posids=None):
+        return np.vstack([poslocTP[0] - self._cal('OFFSET_T', posids),
+                          poslocTP[1] - self._cal('OFFSET_P', posids)])
+
+    def poslocXY_to_flatXY(self, poslocXY, posids=None):
+        return np.vstack([poslocXY[0] + self._cal('OFFSET_X', posids),
+                          poslocXY[1] + self._cal('OFFSET_Y', posids)])
+
+    def flatXY_to_poslocXY(self, flatXY, posids=None):
+        return np.vstack([flatXY[0] - self._cal('OFFSET_X', posids),
+                          flatXY[1] - self._cal('OFFSET_Y', posids)])
+
+    # COMPOSITE TRANSFORMATIONS
+    def posintTP_to_poslocXY(self, posintTP, posids=None):
+        poslocTP = self.posintTP_to_poslocTP(posintTP, posids)
+        return self.poslocTP_to_poslocXY(poslocTP, posids)
+
+    def poslocXY_to_posintTP(self, poslocXY, posids=None, range_limits='full',
+                             t_guess=None, t_guess_tol=pc.default_t_guess_tol):
+        poslocTP, unreachable = self.poslocXY_to_poslocTP(poslocXY, posids, range_limits=range_limits,
+                                                          t_guess=t_guess, t_guess_tol=t_guess_tol)
+        return self.poslocTP_to_posintTP(poslocTP, posids), unreachable
+
+    def obsXY_to_poslocXY(self, obsXY, posids=None):
+        QS = self.obsXY_to_QS(obsXY)
+        return self.QS_to_poslocXY(QS, posids)
+
+    def QS_to_poslocXY(self, QS, posids=None):
+        flatXY = self.QS_to_flatXY(QS)
+        return self.flatXY_to_poslocXY(flatXY, posids)
+
+    def poslocXY_to_QS(self, poslocXY, posids=None):
+        flatXY = self.poslocXY_to_flatXY(poslocXY, posids)
+        return self.flatXY_to_QS(flatXY)
+
+    def posintTP_to_flatXY(self, posintTP, posids=None):
+        poslocXY = self.posintTP_to_poslocXY(posintTP, posids)
+        return self.poslocXY_to_flatXY(poslocXY, posids)
+
+    def flatXY_to_posintTP(self, flatXY, posids=None, range_limits='full',
+                           t_guess=None, t_guess_tol=pc.default_t_guess_tol):
+        poslocXY = self.flatXY_to_poslocXY(flatXY, posids)
+        return self.poslocXY_to_posintTP(poslocXY, posids, range_limits=range_limits,
+                                         t_guess=t_guess, t_guess_tol=t_guess_tol)
+
+    def ptlXY_to_flatXY(self, ptlXY, posids=None):
+        '''Same short-circuit of petaltransforms as PosTransforms.ptlXY_to_flatXY().'''
+        Q_rad = np.arctan2(ptlXY[1], ptlXY[0])
+        R = np.hypot(ptlXY[0], ptlXY[1])
+        S = pc.R2S_lookup(R)
+        return np.vstack([S * np.cos(Q_rad), S * np.sin(Q_rad)])
+
+    def flatXY_to_ptlXY(self, flatXY, posids=None):
+        '''Same short-circuit of petaltransforms as PosTransforms.flatXY_to_ptlXY().'''
+        Q_rad = np.arctan2(flatXY[1], flatXY[0])
+        S = np.hypot(flatXY[0], flatXY[1])
+        R = pc.S2R_lookup(S)
+        return np.vstack([R * np.cos(Q_rad), R * np.sin(Q_rad)])
+
+    def ptlXY_to_poslocXY(self, ptlXY, posids=None):
+        flatXY = self.ptlXY_to_flatXY(ptlXY)
+        return self.flatXY_to_poslocXY(flatXY, posids)
+
+    def ptlXY_to_posintTP(self, ptlXY, posids=None, range_limits='full',
+                          t_guess=None, t_guess_tol=pc.default_t_guess_tol):
+        flatXY = self.ptlXY_to_flatXY(ptlXY)
+        return self.flatXY_to_posintTP(flatXY, posids, range_limits=range_limits,
+                                       t_guess=t_guess, t_guess_tol=t_guess_tol)
+
+    def poslocXY_to_ptlXY(self, poslocXY, posids=None):
+        flatXY = self.poslocXY_to_flatXY(poslocXY, posids)
+        return self.flatXY_to_ptlXY(flatXY)
+
+    def posintTP_to_ptlXY(self, posintTP, posids=None):
+        flatXY = self.posintTP_to_flatXY(posintTP, posids)
+        return self.flatXY_to_ptlXY(flatXY)
+
+    def posintTP_to_QS(self, posintTP, posids=None):
+        flatXY = self.posintTP_to_flatXY(posintTP, posids)
+        return self.flatXY_to_QS(flatXY)
+
+    def QS_to_posintTP(self, QS, posids=None, range_limits='full',
+                       t_guess=None, t_guess_tol=pc.default_t_guess_tol):
+        flatXY = self.QS_to_flatXY(QS)
+        return self.flatXY_to_posintTP(flatXY, posids, range_limits=range_limits,
+                                       t_guess=t_guess, t_guess_tol=t_guess_tol)
+
+    def obsXY_to_posintTP(self, obsXY, posids=None, range_limits='full',
+                          t_guess=None, t_guess_tol=pc.default_t_guess_tol):
+        ptlXY = self.obsXY_to_ptlXY(obsXY)
+        return self.ptlXY_to_posintTP(ptlXY, posids, range_limits=range_limits,
+                                      t_guess=t_guess, t_guess_tol=t_guess_tol)
+
+    def posintTP_to_obsXY(self, posintTP, posids=None):
+        ptlXY = self.posintTP_to_ptlXY(posintTP, posids)
+        return self.ptlXY_to_obsXY(ptlXY)
+
+    def obsXY_to_ptlXY(self, obsXY, posids=None):
+        """Same as PosTransforms.obsXY_to_ptlXY(), with Z from the focal surface."""
+        R = np.hypot(obsXY[0], obsXY[1])
+        obsXYZ = np.vstack([obsXY[0], obsXY[1], pc.R2Z_lookup(R)])
+        return self.obsXYZ_to_ptlXYZ(obsXYZ)[:2, :]
+
+    def ptlXY_to_obsXY(self, ptlXY, posids=None):
+        """Same as PosTransforms.ptlXY_to_obsXY(), with Z from the focal surface."""
+        R = np.hypot(ptlXY[0], ptlXY[1])
+        ptlXYZ = np.vstack([ptlXY[0], ptlXY[1], pc.R2Z_lookup(R)])
+        return self.ptlXYZ_to_obsXYZ(ptlXYZ)[:2, :]
+
+    def expected_positions(self, posintTP, posids=None):
+        """Batch equivalent of PosModel.expected_current_position, for the argued
+        posintTP (2 x N). Returns dict with the same keys, values 2 x N arrays.
+        """
+        QS = self.posintTP_to_QS(posintTP, posids)
+        return {'posintTP': np.asarray(posintTP, dtype=float),
+                'poslocTP': self.posintTP_to_poslocTP(posintTP, posids),
+                'poslocXY': self.posintTP_to_poslocXY(posintTP, posids),
+                'flatXY': self.posintTP_to_flatXY(posintTP, posids),
+                'ptlXY': self.posintTP_to_ptlXY(posintTP, posids),
+                'obsXY': self.QS_to_obsXYZ(QS)[:2, :],
+                'QS': QS}
@@ -6,8 +6,23 @@ import posconstants as pc
 import posanimator
 import configobj
 import os
-import copy as copymodule
 import math
+import threading
+import contextlib
+import json
+import hashlib
+from concurrent.futures import ThreadPoolExecutor
+
+# Methods for checking collisions in time (see PosCollider.spacetime_collision)
+#   'quantized'  ... sample both sweeps at every TIMESTEP
+#   'continuous' ... conservative advancement along the exact, piecewise-linear sweeps
+collision_check_modes = ('quantized', 'continuous')
+
+# Orders in which colliding positioners are resolved within each path adjustment pass
+# (see PosSchedule._schedule_requests_with_path_adjustments)
+#   'posid' ... sorted by posid
+#   'time'  ... earliest collision first, from a priority queue (see PosScheduleStage.adjust_paths_by_time)
+collision_resolution_orders = ('posid', 'time')
 
 class PosCollider(object):
     """PosCollider contains geometry definitions for mechanical components of the
@@ -53,8 +68,30 @@ class PosCollider(object):
         self.keepouts_T = {} # key: posid, value: central body keepout of type PosPoly
         self.keepouts_P = {} # key: posid, value: phi arm keepout of type PosPoly
         self.keepouts_arcP = {} # key: posid, value: phi arm keepout swept through its full range, of type PosPoly
+        self.keepout_radii = {} # key: posid, value: subdict with max radius of 'P' and 'T' keepouts about their rotation axes
         self.keepouts_arcP_resolution = 25 # number of points to add when generating polygonal full-range phi arc
         self.classified_as_retracted = set() # posids of robots classified as retracted. overrides polygonal keepout calcs
+        self.placement_cache_size = 2000 # max number of placed polygons cached per positioner, per keepout type. 0 --> no caching
+        self.placement_cache_quantum = 1e-6 # deg, resolution to which placement angles are rounded (these are also the cache keys)
+        self._placed_P = {} # key: posid, value: dict of placed phi arm PosPolys, keyed by quantized (theta,phi)
+        self._placed_T = {} # key: posid, value: dict of placed central body PosPolys, keyed by quantized theta
+        self.placement_cache_hits = 0
+        self.placement_cache_misses = 0
+        self._placement_lock = threading.Lock() # guards placement cache eviction, when checking collisions in threads
+        self.collision_threads = 1 # number of threads to use in spacetime_collisions(). 1 --> run checks serially
+        self.pair_lookup = None # PosPairLookup instance, if a lookup table file is in use (see _load_pair_lookup)
+        self._pair_lookup_path = '' # file path of the currently loaded lookup table
+        self._pair_lookup_dev = {} # key: posid, value: max deviation (mm) of its keepouts from the nominal ones used in the lookup table
+        self._pair_geometry = {} # key: (posid_A, posid_B), value: (center-to-center distance, bearing angle of B from A)
+        self.pair_lookup_counts = {'clear': 0, 'colliding': 0, 'fallback': 0, 'not applicable': 0}
+        self.fixed_lookup = None # PosFixedLookup instance, if a pos-fixed lookup table file is in use (see _load_fixed_lookup)
+        self._fixed_lookup_path = '' # file path of the currently loaded pos-fixed lookup table
+        self._fixed_lookup_loc = {} # key: posid, value: its index on the pos-fixed table's location axis, or -1 if the table does not apply to it
+        self.fixed_lookup_counts = {'clear': 0, 'colliding': 0, 'fallback': 0, 'not applicable': 0}
+        self._stats_lock = threading.Lock() # guards merging of counts from collision checks made in threads
+        self._collision_pool = None # ThreadPoolExecutor, created upon first threaded use
+        self._collision_pool_size = 0 # number of worker threads in _collision_pool
+        self.snapshot = None # clearances at the end of the last schedule, for warm-starting the next one (see take_snapshot)
 
         # load fixed dictionary containing locations of neighbors for each positioner DEVICE_LOC (if this option has been selected)
         if self.use_neighbor_loc_dict:
@@ -124,20 +161,22 @@ class PosCollider(object):
         for posid,s in sweeps.items():
             if posid in self.posids_to_animate or self.animate_colliding_only:
                 posidx = self.posindexes[posid]
-                for i in range(len(s.time)):
+                sweep_time = s.time
+                sweep_tp = s.tp
+                for i in range(len(sweep_time)):
                     style_override = ''
-                    collision_has_occurred = s.time[i] >= s.collision_time
-                    freezing_has_occurred = s.time[i] >= s.frozen_time
+                    collision_has_occurred = sweep_time[i] >= s.collision_time
+                    freezing_has_occurred = sweep_time[i] >= s.frozen_time
                     if posid in self.classified_as_retracted or not self.posmodels[posid].is_enabled:
                         style_override = 'positioner element unbold'
                     if freezing_has_occurred:
                         style_override = 'frozen'
                     if collision_has_occurred:
                         style_override = 'collision'
-                    time = start_time + s.time[i]
-                    self.animator.add_or_change_item('central body', posidx, time, self.place_central_body(posid, s.tp[i][0]).points, style_override)
-                    self.animator.add_or_change_item('phi arm',      posidx, time, self.place_phi_arm(     posid, s.tp[i]).points, style_override)
-                    self.animator.add_or_change_item('ferrule',      posidx, time, self.place_ferrule(     posid, s.tp[i]).points, style_override)
+                    time = start_time + sweep_time[i]
+                    self.animator.add_or_change_item('central body', posidx, time, self.place_central_body(posid, sweep_tp[i][0]).points, style_override)
+                    self.animator.add_or_change_item('phi arm',      posidx, time, self.place_phi_arm(     posid, sweep_tp[i]).points, style_override)
+                    self.animator.add_or_change_item('ferrule',      posidx, time, self.place_ferrule(     posid, sweep_tp[i]).points, style_override)
                     if collision_has_occurred and s.collision_case == pc.case.GFA:
                         self.animator.add_or_change_item('GFA', '', time, self.keepout_GFA.points, style_override)
                     elif collision_has_occurred and s.collision_case == pc.case.PTL:
@@ -158,6 +197,53 @@ class PosCollider(object):
         """
         return self.spacetime_collision(posid, init_poslocTP, table, skip=skip)
 
+    def spacetime_collisions(self, checks, skip=0):
+        """Batch version of spacetime_collision(), for checking many positioner pairs
+        and fixed boundaries at once (e.g. all those in a schedule stage).
+
+            checks ... list of tuples, each either
+                       (posid_A, init_poslocTP_A, tableA, posid_B, init_poslocTP_B, tableB) for a pair of positioners
+                       (posid_A, init_poslocTP_A, tableA) for a positioner against the fixed keepouts
+            skip ... integer number of initial timesteps for which to skip collision checks
+
+        Returns a list, with one element per check, in the same order as the argued checks.
+        Each element is the list of PosSweeps which spacetime_collision() would return.
+
+        With collider setting COLLISION_THREADS > 1, the checks are distributed across a
+        pool of threads. In the quantized check mode, each check's stepping loop runs in C
+        without the GIL (see _quantized_collision), so the checks really do run
+        concurrently. Only building the sweeps holds the GIL. In the continuous mode,
+        just the polygon kernel releases the GIL, so threads help much less. The
+        results are identical to the serial case.
+        """
+        if self.collision_threads <= 1 or len(checks) <= 1:
+            return [self.spacetime_collision(*check, skip=skip) for check in checks]
+        if self._collision_pool_size != self.collision_threads:
+            if self._collision_pool is not None:
+                self._collision_pool.shutdown()
+            self._collision_pool = ThreadPoolExecutor(max_workers=self.collision_threads, thread_name_prefix='poscollider')
+            self._collision_pool_size = self.collision_threads
+        with self.releasing_gil():
+            return list(self._collision_pool.map(lambda check: self.spacetime_collision(*check, skip=skip), checks))
+
+    @contextlib.contextmanager
+    def releasing_gil(self):
+        """Context within which PosPoly.collides_with() releases the GIL, so that the
+        spatial checks which don't go through _quantized_collision() (e.g. continuous
+        mode, or path adjustment prechecks) can also overlap between threads. Contexts
+        may be nested, or entered from several threads at once.
+
+        Note that the count of active contexts (_release_gil) is module-wide, not per
+        instance. So while any PosCollider in the process is within this context, every
+        PosCollider's polygon checks release the GIL.
+        """
+        global _release_gil
+        _release_gil += 1
+        try:
+            yield
+        finally:
+            _release_gil -= 1
+
     def spacetime_collision(self, posid_A, init_poslocTP_A, tableA,
                                   posid_B=None, init_poslocTP_B=None, tableB=None,
                                   skip=0):
@@ -192,6 +278,159 @@ class PosCollider(object):
 
         The return is a list of instances of PosSweep. (These contain the theta and phi rotations
         in real time, when if any collision, and the collision type and neighbor.)
+
+        When the collider config has COLLISION_CHECK_MODE = 'continuous', the search is
+        delegated to _spacetime_collision_continuous(). See comments there.
+        """
+        if self.check_mode == 'continuous':
+            return self._spacetime_collision_continuous(posid_A, init_poslocTP_A, tableA,
+                                                        posid_B, init_poslocTP_B, tableB,
+                                                        skip=skip)
+        if _polygon_kernel == 2:
+            return self._spacetime_collision_reference(posid_A, init_poslocTP_A, tableA,
+                                                       posid_B, init_poslocTP_B, tableB,
+                                                       skip=skip)
+        posids = [posid_A] if posid_B is None else [posid_A, posid_B]
+        init_poslocTPs = [init_poslocTP_A, init_poslocTP_B]
+        tables = [tableA, tableB]
+        sweeps = []
+        for i in range(len(posids)):
+            sweep = PosSweep(posids[i])
+            sweep.fill_exact(init_poslocTPs[i], tables[i])
+            sweep.quantize(self.timestep)
+            sweeps.append(sweep)
+        collision_case, steps = self._quantized_collision(sweeps, skip)
+        if collision_case != pc.case.I:
+            self._record_collision(sweeps, collision_case, steps)
+        return sweeps
+
+    def _quantized_collision(self, sweeps, Py_ssize_t skip):
+        """Steps through one or two quantized sweeps (pos-pos, or pos-fixed), and
+        returns (collision_case, [step of each sweep at the collision]).
+
+        The stepping loop, polygon placement and spatial checks are all done in C
+        (see _sweeps_collide_c), without holding the GIL. So checks made from several
+        threads run concurrently. The logic and arithmetic are the same as in
+        spatial_collision_between_positioners() and spatial_collision_with_fixed(),
+        including the lookup table and rounding of placement angles to
+        placement_cache_quantum. The placement cache itself is not used, since
+        placing a polygon in a scratch buffer is cheaper than a cache lookup.
+        """
+        cdef _CheckContext ctx
+        cdef _SweepGeom geoms[2]
+        cdef _SweepGeom* geom_B = NULL
+        cdef Py_ssize_t steps[2]
+        cdef int collision_case = pc.case.I
+        cdef int i
+        cdef PosSweep sweep
+        cdef PosPoly poly
+        cdef PosPairLookup pair_lookup = self.pair_lookup
+        cdef PosFixedLookup fixed_lookup = self.fixed_lookup
+        n_sweeps = len(sweeps)
+        posids = [sweep.posid for sweep in sweeps]
+        ctx.Eo_phi = self.Eo_phi
+        ctx.Ei_phi = self.Ei_phi
+        ctx.Eo_radius = self.Eo_radius_with_margin
+        ctx.quantum = self.placement_cache_quantum
+        ctx.kernel = _polygon_kernel
+        ctx.grid = NULL
+        ctx.pair_applies = False
+        ctx.fixed_grid = NULL
+        ctx.fixed_loc = -1
+        ctx.n_clear = ctx.n_colliding = ctx.n_fallback = ctx.n_not_applicable = 0
+        ctx.n_fixed = 0
+        if n_sweeps == 2:
+            if pair_lookup is not None:
+                ctx.grid = &pair_lookup.grid
+                geometry = self._pair_lookup_geometry(posids[0], posids[1])
+                if geometry is not None:
+                    ctx.pair_applies = True
+                    ctx.pair_distance, ctx.pair_bearing = geometry
+        else:
+            if fixed_lookup is not None:
+                ctx.fixed_grid = &fixed_lookup.grid
+                ctx.fixed_loc = self._fixed_lookup_loc.get(posids[0], -1)
+            for fixed_case in self.fixed_neighbor_cases[posids[0]]:
+                poly = self.fixed_neighbor_keepouts[fixed_case]
+                ctx.fixed_case[ctx.n_fixed] = fixed_case
+                ctx.fixed_x[ctx.n_fixed] = poly.x
+                ctx.fixed_y[ctx.n_fixed] = poly.y
+                ctx.fixed_n[ctx.n_fixed] = poly.n_pts
+                ctx.n_fixed += 1
+        for i in range(n_sweeps):
+            geoms[i].placed_arm_x = geoms[i].placed_arm_y = NULL
+            geoms[i].placed_body_x = geoms[i].placed_body_y = NULL
+        try:
+            for i in range(n_sweeps):
+                sweep = sweeps[i]
+                posid = posids[i]
+                geoms[i].theta = sweep._theta
+                geoms[i].phi = sweep._phi
+                geoms[i].moving = sweep._moving
+                geoms[i].n = sweep._n
+                geoms[i].x0 = self.x0[posid]
+                geoms[i].y0 = self.y0[posid]
+                geoms[i].r1 = self.R1[posid]
+                geoms[i].retracted = posid in self.classified_as_retracted
+                poly = self.keepouts_P[posid]
+                geoms[i].arm_x = poly.x
+                geoms[i].arm_y = poly.y
+                geoms[i].n_arm = poly.n_pts
+                geoms[i].placed_arm_x = <double*> PyMem_Malloc(poly.n_pts * sizeof(double))
+                geoms[i].placed_arm_y = <double*> PyMem_Malloc(poly.n_pts * sizeof(double))
+                poly = self.keepouts_T[posid]
+                geoms[i].body_x = poly.x
+                geoms[i].body_y = poly.y
+                geoms[i].n_body = poly.n_pts
+                geoms[i].placed_body_x = <double*> PyMem_Malloc(poly.n_pts * sizeof(double))
+                geoms[i].placed_body_y = <double*> PyMem_Malloc(poly.n_pts * sizeof(double))
+                if not (geoms[i].placed_arm_x and geoms[i].placed_arm_y and geoms[i].placed_body_x and geoms[i].placed_body_y):
+                    raise MemoryError()
+                geoms[i].arm_t = geoms[i].arm_p = geoms[i].body_t = NAN
+            if n_sweeps == 2:
+                geom_B = &geoms[1]
+            steps[0] = steps[1] = 0
+            with nogil:
+                collision_case = _sweeps_collide_c(&ctx, &geoms[0], geom_B, skip, steps)
+        finally:
+            for i in range(n_sweeps):
+                PyMem_Free(geoms[i].placed_arm_x)
+                PyMem_Free(geoms[i].placed_arm_y)
+                PyMem_Free(geoms[i].placed_body_x)
+                PyMem_Free(geoms[i].placed_body_y)
+        if ctx.grid != NULL or ctx.fixed_grid != NULL:
+            counts = self.pair_lookup_counts if ctx.grid != NULL else self.fixed_lookup_counts
+            with self._stats_lock:
+                counts['clear'] += ctx.n_clear
+                counts['colliding'] += ctx.n_colliding
+                counts['fallback'] += ctx.n_fallback
+                counts['not applicable'] += ctx.n_not_applicable
+        return collision_case, [steps[i] for i in range(n_sweeps)]
+
+    def _record_collision(self, sweeps, collision_case, steps):
+        """Stores collision info in the argued sweeps (one, or a pos-pos pair), given
+        the step index of each sweep at which collision_case was detected.
+        """
+        pos_range = list(range(len(sweeps)))
+        for i, j in zip(pos_range, pos_range[::-1]):
+            sweeps[i].collision_case = collision_case
+            if len(sweeps) == 2:
+                sweeps[i].collision_neighbor = sweeps[j].posid
+                possible_collision_times = {sweeps[i].time_at(steps[i]):steps[i], sweeps[j].time_at(steps[j]):steps[j]} # key: time value, value: step index
+                sweeps[i].collision_time = max(possible_collision_times)
+                sweeps[i].collision_idx = possible_collision_times[sweeps[i].collision_time]
+            else:
+                sweeps[i].collision_neighbor = 'PTL' if collision_case == pc.case.PTL else 'GFA'
+                sweeps[i].collision_time = sweeps[i].time_at(steps[i])
+                sweeps[i].collision_idx = steps[i]
+
+    def _spacetime_collision_reference(self, posid_A, init_poslocTP_A, tableA,
+                                             posid_B=None, init_poslocTP_B=None, tableB=None,
+                                             skip=0):
+        """Reference implementation of the quantized spacetime_collision(), stepping
+        through the sweeps in python, with spatial checks by the usual methods. Used
+        when the polygon kernel is in 'compare' mode (see set_polygon_kernel), so
+        that every polygon check can be compared.
         """
         pospos = posid_B is not None
         if pospos:
@@ -208,34 +447,23 @@ class PosCollider(object):
             steps_remaining = [0]
             step = [0]
             pos_range = [0]
-        rev_pos_range = pos_range[::-1]
         for i in pos_range:
             sweeps[i].fill_exact(init_poslocTPs[i], tables[i])
             sweeps[i].quantize(self.timestep)
-            steps_remaining[i] = len(sweeps[i].time)
+            steps_remaining[i] = len(sweeps[i])
         while any(steps_remaining):
             check_collision_this_loop = False
             for i in pos_range:
-                if sweeps[i].was_moving_cached[step[i]] and step[i] >= skip:
+                if sweeps[i].was_moving(step[i]) and step[i] >= skip:
                     check_collision_this_loop = True
             if check_collision_this_loop:
                 if pospos:
-                    collision_case = self.spatial_collision_between_positioners(posid_A, posid_B, sweeps[0].tp[step[0]], sweeps[1].tp[step[1]])
+                    collision_case = self.spatial_collision_between_positioners(posid_A, posid_B, sweeps[0].tp_at(step[0]), sweeps[1].tp_at(step[1]))
                 else:
-                    collision_case = self.spatial_collision_with_fixed(posid_A, sweeps[0].tp[step[0]])
+                    collision_case = self.spatial_collision_with_fixed(posid_A, sweeps[0].tp_at(step[0]))
                 if collision_case != pc.case.I:
-                    for i, j in zip(pos_range, rev_pos_range):
-                        sweeps[i].collision_case = collision_case
-                        if pospos:
-                            sweeps[i].collision_neighbor = sweeps[j].posid
-                            possible_collision_times = {sweeps[i].time[step[i]]:step[i], sweeps[j].time[step[j]]:step[j]} # key: time value, value: step index
-                            sweeps[i].collision_time = max(possible_collision_times)
-                            sweeps[i].collision_idx = possible_collision_times[sweeps[i].collision_time]
-                        else:
-                            sweeps[i].collision_neighbor = 'PTL' if collision_case == pc.case.PTL else 'GFA'
-                            sweeps[i].collision_time = sweeps[i].time[step[i]]
-                            sweeps[i].collision_idx = step[i]
-                        steps_remaining[i] = 0 # halt the sweep here
+                    self._record_collision(sweeps, collision_case, step)
+                    return sweeps
             steps_remaining = [max(step-1,0) for step in steps_remaining]
             for i in pos_range:
                 if steps_remaining[i]:
@@ -244,6 +472,240 @@ class PosCollider(object):
                     pass
         return sweeps
 
+    def _spacetime_collision_continuous(self, posid_A, init_poslocTP_A, tableA,
+                                              posid_B=None, init_poslocTP_B=None, tableB=None,
+                                              skip=0):
+        """Like spacetime_collision(), but finds the first time of contact along the
+        exact (unquantized) sweeps, using conservative advancement.
+
+        Each row of a move table is linear in (theta,phi) vs time. So between the
+        merged breakpoints of the two sweeps, both positioners rotate at constant
+        rates, and the speed of any polygon point is bounded by:
+
+            phi arm ........ |dT/dt| * (R1 + r_P) + |dP/dt| * r_P
+            central body ... |dT/dt| * r_T
+
+        where r_P and r_T are the max radii of the keepout polygons about their axes.
+        Time is advanced by (clearance / max relative speed), which cannot skip over a
+        contact. Only when clearance falls below CONTACT_TOL is the exact spatial
+        collision check made. The clearance is taken over all polygon pairs which
+        might be checked, ignoring the retracted envelope logic, so it is always a
+        conservative lower bound.
+
+        The returned sweeps are still quantized at TIMESTEP (so that downstream
+        code like animations and table adjustments works the same), but the
+        collision_time is the exact time of first contact, and collision_idx is the
+        first quantized step at or after that time.
+
+        The argument skip means collisions before (start + skip * TIMESTEP) are ignored.
+        As in the quantized mode, skip=0 is treated like skip=1, so that polygons
+        already overlapping at the start (e.g. when debouncing) are not reported
+        unless they remain in contact one TIMESTEP later. Contacts are only searched
+        for while at least one positioner is moving.
+        """
+        pospos = posid_B is not None
+        posids = [posid_A, posid_B] if pospos else [posid_A]
+        init_poslocTPs = [init_poslocTP_A, init_poslocTP_B]
+        tables = [tableA, tableB]
+        exact = []
+        sweeps = []
+        for i in range(len(posids)):
+            sweep = PosSweep(posids[i])
+            sweep.fill_exact(init_poslocTPs[i], tables[i])
+            exact.append(sweep)
+            sweep = sweep.copy()
+            sweep.quantize(self.timestep)
+            sweeps.append(sweep)
+        if not pospos and not self.fixed_neighbor_cases[posid_A]:
+            return sweeps
+        start_time = exact[0].time_at(0)
+        min_time = start_time + max(skip, 1) * self.timestep
+        breakpoints = sorted(set().union(*[s.time for s in exact]))
+        deg2rad = pc.rad_per_deg
+        for k in range(len(breakpoints) - 1):
+            t_lo = breakpoints[k]
+            t_hi = breakpoints[k+1]
+            if t_hi <= min_time:
+                continue
+            tp_lo = [s.tp_at_time(t_lo) for s in exact]
+            tp_hi = [s.tp_at_time(t_hi) for s in exact]
+            duration = t_hi - t_lo
+            rates = [[(hi[0] - lo[0]) / duration, (hi[1] - lo[1]) / duration] for lo, hi in zip(tp_lo, tp_hi)]
+            max_speed = 0.0
+            for i in range(len(posids)):
+                w_T = abs(rates[i][0]) * deg2rad
+                w_P = abs(rates[i][1]) * deg2rad
+                r = self.keepout_radii[posids[i]]
+                max_speed += max(w_T * (self.R1[posids[i]] + r['P']) + w_P * r['P'], w_T * r['T'])
+            if max_speed <= 0.0:
+                continue # nothing moving in this interval
+            t = max(t_lo, min_time)
+            while True:
+                tps = [[lo[0] + rate[0] * (t - t_lo), lo[1] + rate[1] * (t - t_lo)] for lo, rate in zip(tp_lo, rates)]
+                if pospos:
+                    clearance = self._clearance_between_positioners(posid_A, posid_B, tps[0], tps[1])
+                else:
+                    clearance = self._clearance_with_fixed(posid_A, tps[0])
+                if clearance <= self.contact_tol:
+                    if pospos:
+                        collision_case = self.spatial_collision_between_positioners(posid_A, posid_B, tps[0], tps[1])
+                    else:
+                        collision_case = self.spatial_collision_with_fixed(posid_A, tps[0])
+                    if collision_case != pc.case.I:
+                        for i in range(len(posids)):
+                            sweeps[i].collision_case = collision_case
+                            if pospos:
+                                sweeps[i].collision_neighbor = posids[1-i]
+                            else:
+                                sweeps[i].collision_neighbor = 'PTL' if collision_case == pc.case.PTL else 'GFA'
+                            sweeps[i].collision_time = t
+                            sweeps[i].collision_idx = sweeps[i].step_at_time(t)
+                        return sweeps
+                if t >= t_hi:
+                    break
+                t = min(t + max(clearance, self.contact_tol) / max_speed, t_hi)
+        return sweeps
+
+    def _clearance_between_positioners(self, posid_A, posid_B, poslocTP_A, poslocTP_B):
+        """Lower bound on the distance between the keepouts of two positioners, for
+        continuous collision checking. Includes every pair of polygons which might
+        be checked by spatial_collision_between_positioners().
+        """
+        cdef PosPoly arm_A = self.keepouts_P[posid_A].place_as_phi_arm(poslocTP_A[0], poslocTP_A[1], self.x0[posid_A], self.y0[posid_A], self.R1[posid_A])
+        cdef PosPoly arm_B = self.keepouts_P[posid_B].place_as_phi_arm(poslocTP_B[0], poslocTP_B[1], self.x0[posid_B], self.y0[posid_B], self.R1[posid_B])
+        cdef PosPoly body_A = self.keepouts_T[posid_A].place_as_central_body(poslocTP_A[0], self.x0[posid_A], self.y0[posid_A])
+        cdef PosPoly body_B = self.keepouts_T[posid_B].place_as_central_body(poslocTP_B[0], self.x0[posid_B], self.y0[posid_B])
+        clearance = min(arm_A.distance_to(arm_B), arm_A.distance_to(body_B), arm_B.distance_to(body_A))
+        if posid_B in self.classified_as_retracted:
+            clearance = min(clearance, arm_A.distance_to_circle(self.x0[posid_B], self.y0[posid_B], self.Eo_radius_with_margin))
+        if posid_A in self.classified_as_retracted:
+            clearance = min(clearance, arm_B.distance_to_circle(self.x0[posid_A], self.y0[posid_A], self.Eo_radius_with_margin))
+        return clearance
+
+    def _clearance_with_fixed(self, posid, poslocTP):
+        """Lower bound on the distance between a positioner's phi arm and its fixed
+        neighbor keepouts, for continuous collision checking.
+        """
+        cdef PosPoly arm = self.keepouts_P[posid].place_as_phi_arm(poslocTP[0], poslocTP[1], self.x0[posid], self.y0[posid], self.R1[posid])
+        cdef PosPoly fixed
+        clearance = math.inf
+        for fixed_case in self.fixed_neighbor_cases[posid]:
+            fixed = self.fixed_neighbor_keepouts[fixed_case]
+            clearance = min(clearance, arm.distance_to(fixed))
+        return clearance
+
+    def take_snapshot(self, poslocTP):
+        """Stores the clearances (mm) between all neighboring positioners, and to their
+        fixed boundaries, with positioners placed at poslocTP (dict with keys = posids,
+        values = [theta, phi]). Intended to be called with the final positions of a
+        schedule, so that checks in the following schedule (e.g. a small correction
+        move) can be pruned by comparison with max_displacement(). The snapshot is
+        discarded if refreshing calibrations changes any of the keepout geometry.
+        """
+        pospos = {}
+        fixed = {}
+        for posid_A, tp_A in poslocTP.items():
+            for posid_B in self.pos_neighbors[posid_A]:
+                if posid_B in poslocTP and (posid_B, posid_A) not in pospos:
+                    pospos[(posid_A, posid_B)] = self._clearance_between_positioners(posid_A, posid_B, tp_A, poslocTP[posid_B])
+            if self.fixed_neighbor_cases[posid_A]:
+                fixed[posid_A] = self._clearance_with_fixed(posid_A, tp_A)
+        self.snapshot = {'poslocTP': {posid: tuple(tp) for posid, tp in poslocTP.items()},
+                         'pospos': pospos, 'fixed': fixed, 'geometry': self._geometry_fingerprint()}
+
+    def _geometry_fingerprint(self):
+        """Returns hash of all positioner parameters and config values which determine
+        the placed keepout polygons."""
+        params = tuple((posid, self.R1[posid], self.R2[posid], self.x0[posid], self.y0[posid],
+                        tuple(sorted(self.keepout_expansions[posid].items())), posid in self.classified_as_retracted)
+                       for posid in sorted(self.posids))
+        return hash((params, repr(sorted(self.config.items()))))
+
+    def snapshot_clearance(self, posid_A, posid_B=None):
+        """Returns clearance in the stored snapshot between two neighboring positioners,
+        or of posid_A to its fixed boundaries if posid_B is None. Returns None if not
+        available.
+        """
+        if self.snapshot is None:
+            return None
+        if posid_B is None:
+            return self.snapshot['fixed'].get(posid_A)
+        pospos = self.snapshot['pospos']
+        if (posid_A, posid_B) in pospos:
+            return pospos[(posid_A, posid_B)]
+        return pospos.get((posid_B, posid_A))
+
+    def max_displacement(self, posid, ref_poslocTP, T_range, P_range):
+        """Upper bound on the distance (mm) any point of the positioner's keepouts may
+        move away from its placement at ref_poslocTP, for theta and phi anywhere within
+        the argued (min, max) ranges (deg). Uses the same arc length bounds as the
+        speed estimate for 'continuous' collision checking.
+        """
+        deg2rad = pc.rad_per_deg
+        dT = max(abs(T_range[0] - ref_poslocTP[0]), abs(T_range[1] - ref_poslocTP[0])) * deg2rad
+        dP = max(abs(P_range[0] - ref_poslocTP[1]), abs(P_range[1] - ref_poslocTP[1])) * deg2rad
+        r = self.keepout_radii[posid]
+        return max(dT * (self.R1[posid] + r['P']) + dP * r['P'], dT * r['T'])
+
+    def make_sweep(self, posid, init_poslocTP, table):
+        """Returns a quantized PosSweep for the argued table, with no collision
+        checking performed.
+        """
+        sweep = PosSweep(posid)
+        sweep.fill_exact(init_poslocTP, table)
+        sweep.quantize(self.timestep)
+        return sweep
+
+    def sweep_envelopes(self, posid, init_poslocTP, table):
+        """Returns a dict of polygons which bound the whole region of space occupied
+        by a positioner's keepouts, over the course of executing the argued table.
+        Used for quickly ruling out pairs of positioners which cannot possibly
+        collide (see envelopes_may_collide).
+
+            'arm'  ... annular sector about the positioner center, containing the phi arm
+                       at every (theta,phi) within the ranges swept by the table
+            'body' ... the placed central body if theta is stationary, else a disk
+                       containing it at any theta
+            'Eo'   ... only for positioners classified as retracted, their Eo circle
+        """
+        sweep = PosSweep(posid)
+        sweep.fill_exact(init_poslocTP, table)
+        tp = sweep.tp
+        T = [x[0] for x in tp]
+        P = [x[1] for x in tp]
+        t_min, t_max, p_min, p_max = min(T), max(T), min(P), max(P)
+        envelopes = {}
+        if t_min == t_max and p_min == p_max:
+            envelopes['arm'] = self.place_phi_arm(posid, [t_min, p_min])
+        else:
+            envelopes['arm'] = _phi_arm_envelope(self.keepouts_P[posid], self.R1[posid],
+                                                 t_min, t_max, p_min, p_max,
+                                                 self.x0[posid], self.y0[posid],
+                                                 self.config['RESOLUTION_EO'])
+        if t_min == t_max:
+            envelopes['body'] = self.place_central_body(posid, t_min)
+        else:
+            envelopes['body'] = self.body_disk_polys[posid]
+        if posid in self.classified_as_retracted:
+            envelopes['Eo'] = self.Eo_polys[posid]
+        return envelopes
+
+    def envelopes_may_collide(self, envelopes_A, envelopes_B):
+        """Checks whether the sweep envelopes (see sweep_envelopes) of two positioners
+        intersect anywhere. Returns False only if it is impossible for the two
+        positioners' sweeps to collide. Covers every combination of polygons which
+        might be checked by spatial_collision_between_positioners().
+        """
+        cdef PosPoly arm_A = envelopes_A['arm']
+        cdef PosPoly arm_B = envelopes_B['arm']
+        if arm_A.overlaps(arm_B) or arm_A.overlaps(envelopes_B['body']) or arm_B.overlaps(envelopes_A['body']):
+            return True
+        if 'Eo' in envelopes_B and arm_A.overlaps(envelopes_B['Eo']):
+            return True
+        if 'Eo' in envelopes_A and arm_B.overlaps(envelopes_A['Eo']):
+            return True
+        return False
+
     def spatial_collision_between_positioners(self, posid_A, posid_B, poslocTP_A, poslocTP_B):
         """Searches for collisions in space between two fiber positioners.
 
@@ -281,6 +743,14 @@ class PosCollider(object):
             else:
                 return pc.case.I
         else: # check cases II and III
+            if self.pair_lookup is not None:
+                cell = self._lookup_pair(posid_A, posid_B, poslocTP_A, poslocTP_B)
+                if cell == _CELL_CLEAR:
+                    return pc.case.I
+                elif cell == _CELL_CASE_III:
+                    return pc.case.III
+                elif cell == _CELL_CASE_II:
+                    return pc.case.II
             if self._case_III_collision(posid_A, posid_B, poslocTP_A, poslocTP_B[0]):
                 return pc.case.III
             elif self._case_III_collision(posid_B, posid_A, poslocTP_B, poslocTP_A[0]):
@@ -303,10 +773,19 @@ class PosCollider(object):
 
         The return is an enumeration of type "case", indicating what kind of collision
         was first detected, if any.
+
+        If a pos-fixed lookup table is in use (collider setting COLLISION_FIXED_LOOKUP_TABLE),
+        it answers for the phi arm wherever its cell is definitely clear or colliding.
         """
         cdef PosPoly poly1
         cdef PosPoly poly2
         if self.fixed_neighbor_cases[posid]:
+            if self.fixed_lookup is not None and not use_phi_arc:
+                cell = self._lookup_fixed(posid, poslocTP)
+                if cell == _CELL_CLEAR:
+                    return pc.case.I
+                elif cell == _CELL_GFA or cell == _CELL_PTL:
+                    return cell
             if use_phi_arc:
                 poly1 = self.place_phi_arc(posid, poslocTP[0])
             else:
@@ -362,12 +841,26 @@ class PosCollider(object):
     def place_phi_arm(self, posid, poslocTP):
         """Rotates and translates the phi arm to position defined by the positioner's
         (x0,y0) and the argued poslocTP (theta,phi) angles.
+
+        The angles are rounded to placement_cache_quantum, and the polygon is placed
+        at the rounded angles, so that results never depend on the cache contents.
+        Placed polygons are cached (see placement_cache_stats). The returned PosPoly
+        may therefore be shared, and must not be modified in place.
         """
-        return self.keepouts_P[posid].place_as_phi_arm(theta=poslocTP[0],
-                                                       phi=poslocTP[1],
+        q = self.placement_cache_quantum
+        key = (round(poslocTP[0] / q), round(poslocTP[1] / q))
+        cache = self._placed_P[posid]
+        if key in cache:
+            self.placement_cache_hits += 1
+            return cache[key]
+        self.placement_cache_misses += 1
+        poly = self.keepouts_P[posid].place_as_phi_arm(theta=key[0] * q,
+                                                       phi=key[1] * q,
                                                        x0=self.x0[posid],
                                                        y0=self.y0[posid],
                                                        r1=self.R1[posid])
+        self._store_placement(cache, key, poly)
+        return poly
 
     def place_phi_arc(self, posid, poslocT):
         """Rotates and translates the full-range phi arc to position defined by the
@@ -383,10 +876,57 @@ class PosCollider(object):
     def place_central_body(self, posid, poslocT):
         """Rotates and translates the central body of positioner
         to its (x0,y0) and the argued poslocT theta angle.
+
+        As in place_phi_arm(), the polygon is placed at the angle rounded to
+        placement_cache_quantum. Placed polygons are cached (see placement_cache_stats).
+        The returned PosPoly may therefore be shared, and must not be modified in place.
         """
-        return self.keepouts_T[posid].place_as_central_body(theta=poslocT,
+        q = self.placement_cache_quantum
+        key = round(poslocT / q)
+        cache = self._placed_T[posid]
+        if key in cache:
+            self.placement_cache_hits += 1
+            return cache[key]
+        self.placement_cache_misses += 1
+        poly = self.keepouts_T[posid].place_as_central_body(theta=key * q,
                                                             x0=self.x0[posid],
                                                             y0=self.y0[posid])
+        self._store_placement(cache, key, poly)
+        return poly
+
+    def _store_placement(self, cache, key, poly):
+        """Add a placed polygon to one positioner's placement cache, evicting the
+        oldest entry if the cache is full.
+        """
+        if self.placement_cache_size <= 0:
+            return
+        with self._placement_lock:
+            if len(cache) >= self.placement_cache_size:
+                del cache[next(iter(cache))]
+            cache[key] = poly
+
+    def clear_placement_cache(self):
+        """Empties the cache of placed phi arm and central body polygons. Must be
+        called whenever the keepouts or positioner calibrations change (this happens
+        automatically upon refresh_calibrations).
+        """
+        self._placed_P = {posid: {} for posid in self.posids}
+        self._placed_T = {posid: {} for posid in self.posids}
+
+    def placement_cache_stats(self, reset=False):
+        """Returns dict of hit / miss counts and current size of the placed polygon
+        cache. Optionally resets the hit / miss counters afterward.
+        """
+        total = self.placement_cache_hits + self.placement_cache_misses
+        stats = {'hits': self.placement_cache_hits,
+                 'misses': self.placement_cache_misses,
+                 'hit rate': self.placement_cache_hits / total if total else 0.0,
+                 'num cached': sum(len(c) for c in self._placed_P.values()) + sum(len(c) for c in self._placed_T.values()),
+                 'max per positioner': self.placement_cache_size}
+        if reset:
+            self.placement_cache_hits = 0
+            self.placement_cache_misses = 0
+        return stats
 
     def place_arm_lines(self, posid, poslocTP):
         '''Generates, rotates, and translates a PosPoly with two lines through the
@@ -422,6 +962,166 @@ class PosCollider(object):
         poly = poly.translated(self.x0[posid], self.y0[posid])
         return poly
 
+    def _load_pair_lookup(self, path):
+        """Loads a PosPairLookup table from file (see save_pair_lookup), for use by
+        spatial_collision_between_positioners(). A relative path is taken to be in the
+        collision_settings directory. An empty path means no table is used.
+
+        The table is only used if it was generated for the same nominal keepouts as are
+        currently loaded. And it is only applied to positioners whose actual keepouts
+        deviate from nominal by less than the table's built-in geometry slack.
+        """
+        self._pair_geometry = {}
+        if not path:
+            self.pair_lookup = None
+            self._pair_lookup_path = ''
+            return
+        if not os.path.isabs(path):
+            path = os.path.join(pc.dirs['collision_settings'], path)
+        if path != self._pair_lookup_path:
+            self.pair_lookup = load_pair_lookup(path)
+            self._pair_lookup_path = path
+        expected_hash = keepouts_hash(self.general_keepout_P, self.general_keepout_T, pc.nominals['LENGTH_R1']['value'])
+        if self.pair_lookup.header['keepout_hash'] != expected_hash:
+            self.printfunc(f'PosCollider: collision lookup table {path} was generated for different keepouts. It will not be used.')
+            self.pair_lookup = None
+            self._pair_lookup_path = ''
+            return
+        R1_nom = pc.nominals['LENGTH_R1']['value']
+        self._pair_lookup_dev = {}
+        for posid in self.posids:
+            dev_P = self.keepouts_P[posid].max_deviation_from(self.general_keepout_P, self.R1[posid] - R1_nom)
+            dev_T = self.keepouts_T[posid].max_deviation_from(self.general_keepout_T, 0.0)
+            self._pair_lookup_dev[posid] = max(dev_P, dev_T)
+
+    def _lookup_pair(self, posid_A, posid_B, poslocTP_A, poslocTP_B):
+        """Returns the PosPairLookup cell value for two positioners, or _CELL_UNCERTAIN
+        if the table does not apply to them.
+        """
+        geometry = self._pair_lookup_geometry(posid_A, posid_B)
+        if geometry is None:
+            cell = _CELL_UNCERTAIN
+            count = 'not applicable'
+        else:
+            distance, bearing = geometry
+            cell = self.pair_lookup.lookup(distance, poslocTP_A[0] - bearing, poslocTP_A[1], poslocTP_B[0] - bearing, poslocTP_B[1])
+            if cell == _CELL_CLEAR:
+                count = 'clear'
+            elif cell == _CELL_UNCERTAIN:
+                count = 'fallback'
+            elif cell == _CELL_OUTSIDE:
+                count = 'not applicable'
+            else:
+                count = 'colliding'
+        with self._stats_lock: # may be called from several threads (see spacetime_collisions and releasing_gil)
+            self.pair_lookup_counts[count] += 1
+        return cell
+
+    def _pair_lookup_geometry(self, posid_A, posid_B):
+        """Returns (center-to-center distance, bearing angle of B from A) for use with
+        the PosPairLookup table, or None if the table does not apply to the pair.
+        """
+        key = (posid_A, posid_B)
+        if key not in self._pair_geometry:
+            dx = self.x0[posid_B] - self.x0[posid_A]
+            dy = self.y0[posid_B] - self.y0[posid_A]
+            if self._pair_lookup_dev[posid_A] + self._pair_lookup_dev[posid_B] > self.pair_lookup.geometry_slack:
+                self._pair_geometry[key] = None
+            else:
+                self._pair_geometry[key] = (math.hypot(dx, dy), math.degrees(math.atan2(dy, dx)))
+        return self._pair_geometry[key]
+
+    def _load_fixed_lookup(self, path):
+        """Loads a PosFixedLookup table from file, for use by spatial_collision_with_fixed().
+        A relative path is taken to be in the collision_settings directory. An empty path
+        means no table is used.
+
+        As with the pos-pos table, it is only used if generated for the currently loaded
+        nominal keepouts. And it is only applied to positioners whose device location is
+        in the table, and whose center and phi keepout together deviate from nominal by
+        less than the table's geometry slack.
+        """
+        self._fixed_lookup_loc = {}
+        if not path:
+            self.fixed_lookup = None
+            self._fixed_lookup_path = ''
+            return
+        if not os.path.isabs(path):
+            path = os.path.join(pc.dirs['collision_settings'], path)
+        if path != self._fixed_lookup_path:
+            self.fixed_lookup = load_fixed_lookup(path)
+            self._fixed_lookup_path = path
+        R1_nom = pc.nominals['LENGTH_R1']['value']
+        expected_hash = fixed_keepouts_hash(self.general_keepout_P, self.keepout_PTL, self.keepout_GFA, R1_nom)
+        if self.fixed_lookup.header['keepout_hash'] != expected_hash:
+            self.printfunc(f'PosCollider: pos-fixed collision lookup table {path} was generated for different keepouts. It will not be used.')
+            self.fixed_lookup = None
+            self._fixed_lookup_path = ''
+            return
+        for posid in self.posids:
+            loc = self.posmodels[posid].deviceloc
+            center = self.fixed_lookup.nominal_center(loc)
+            self._fixed_lookup_loc[posid] = -1
+            if center is not None:
+                dev_center = math.hypot(self.x0[posid] - center[0], self.y0[posid] - center[1])
+                dev_P = self.keepouts_P[posid].max_deviation_from(self.general_keepout_P, self.R1[posid] - R1_nom)
+                if dev_center + dev_P <= self.fixed_lookup.geometry_slack:
+                    self._fixed_lookup_loc[posid] = self.fixed_lookup.loc_index[loc]
+
+    def _lookup_fixed(self, posid, poslocTP):
+        """Returns the PosFixedLookup cell value for a positioner, or _CELL_UNCERTAIN
+        if the table does not apply to it.
+        """
+        cdef PosFixedLookup fixed_lookup = self.fixed_lookup
+        i_loc = self._fixed_lookup_loc.get(posid, -1)
+        if i_loc < 0:
+            cell = _CELL_UNCERTAIN
+            count = 'not applicable'
+        else:
+            cell = _fixed_cell(&fixed_lookup.grid, i_loc, poslocTP[0], poslocTP[1])
+            if cell == _CELL_CLEAR:
+                count = 'clear'
+            elif cell == _CELL_UNCERTAIN:
+                count = 'fallback'
+            elif cell == _CELL_OUTSIDE:
+                count = 'not applicable'
+            else:
+                count = 'colliding'
+        with self._stats_lock:
+            self.fixed_lookup_counts[count] += 1
+        return cell
+
+    def fixed_lookup_stats(self, reset=False):
+        """Same as pair_lookup_stats(), for the checks against fixed keepouts answered
+        by the pos-fixed lookup table.
+        """
+        with self._stats_lock:
+            counts = dict(self.fixed_lookup_counts)
+            if reset:
+                self.fixed_lookup_counts = {key: 0 for key in counts}
+        total = sum(counts.values())
+        stats = dict(counts)
+        stats['hit rate'] = (counts['clear'] + counts['colliding']) / total if total else 0.0
+        stats['table'] = self._fixed_lookup_path
+        return stats
+
+    def pair_lookup_stats(self, reset=False):
+        """Returns a dict of counts of spatial pos-pos checks answered by the collision
+        lookup table ('clear', 'colliding'), those which fell back to exact polygon
+        checks because the table cell was uncertain ('fallback'), or because the table
+        did not cover the positioners' geometry or angles ('not applicable'). Also the
+        fraction of checks answered by the table. Optionally reset the counts.
+        """
+        with self._stats_lock:
+            counts = dict(self.pair_lookup_counts)
+            if reset:
+                self.pair_lookup_counts = {key: 0 for key in counts}
+        total = sum(counts.values())
+        stats = dict(counts)
+        stats['hit rate'] = (counts['clear'] + counts['colliding']) / total if total else 0.0
+        stats['table'] = self._pair_lookup_path
+        return stats
+
     def _case_II_collision(self, posid1, posid2, tp1, tp2):
         """Search for case II collision, positioner 1 arm against positioner 2 arm."""
         cdef PosPoly poly1
@@ -449,11 +1149,29 @@ class PosCollider(object):
         polygon definitions, and updates stored values accordingly.
         """
         self.timestep = self.config['TIMESTEP']
+        self.check_mode = self.config.get('COLLISION_CHECK_MODE', 'quantized')
+        assert self.check_mode in collision_check_modes, f'PosCollider: invalid COLLISION_CHECK_MODE {self.check_mode}. Must be one of {collision_check_modes}'
+        self.contact_tol = self.config.get('CONTACT_TOL', 0.001)
+        self.prune_pairs = self.config.get('PRUNE_NEIGHBOR_PAIRS', True)
+        self.warm_start = self.config.get('WARM_START_PRUNING', False)
+        self.warm_start_margin = self.config.get('WARM_START_MARGIN', 0.5)
+        self.parallel_adjustment = self.config.get('PARALLEL_ADJUSTMENT', False)
+        self.combined_adjustments = self.config.get('COMBINED_ADJUSTMENTS', False)
+        self.parallel_components = self.config.get('PARALLEL_COMPONENTS', False)
+        self.resolution_order = self.config.get('COLLISION_RESOLUTION_ORDER', 'posid')
+        assert self.resolution_order in collision_resolution_orders, f'PosCollider: invalid COLLISION_RESOLUTION_ORDER {self.resolution_order}. Must be one of {collision_resolution_orders}'
+        self.placement_cache_size = self.config.get('PLACEMENT_CACHE_SIZE', self.placement_cache_size)
+        self.collision_threads = max(1, int(self.config.get('COLLISION_THREADS', self.collision_threads)))
         self._load_positioner_params(verbose=verbose)
         self._load_keepouts()
         self._adjust_keepouts()
         self._load_circle_envelopes()
         self._load_keepouts_arcP()
+        self.clear_placement_cache()
+        self._load_pair_lookup(self.config.get('COLLISION_LOOKUP_TABLE', ''))
+        self._load_fixed_lookup(self.config.get('COLLISION_FIXED_LOOKUP_TABLE', ''))
+        if self.snapshot is not None and self.snapshot['geometry'] != self._geometry_fingerprint():
+            self.snapshot = None
 
     def _load_positioner_params(self, verbose=True):
         """Read latest versions of all positioner parameters."""
@@ -499,6 +1217,7 @@ class PosCollider(object):
             keepout_T = keepout_T.expanded_angularly(expansions['KEEPOUT_EXPANSION_THETA_ANGULAR'])
             self.keepouts_P[posid] = keepout_P
             self.keepouts_T[posid] = keepout_T
+            self.keepout_radii[posid] = {'P': keepout_P.max_radius(), 'T': keepout_T.max_radius()}
 
     def _load_circle_envelopes(self):
         """Read latest versions of all circular envelopes, including outer clear rotation
@@ -523,6 +1242,7 @@ class PosCollider(object):
         self.Ei_polys = {}
         self.Ee_polys = {}
         self.line_t0_polys = {}
+        self.body_disk_polys = {}
         for posid in self.posids:
             x = self.x0[posid]
             y = self.y0[posid]
@@ -534,6 +1254,7 @@ class PosCollider(object):
             self.Ei_polys[posid] = self.Ei_poly.translated(x,y)
             self.Ee_polys[posid] = self.Ee_poly.translated(x,y)
             self.line_t0_polys[posid] = self.line_t0_poly.rotated(self.t0[posid]).translated(x,y)
+            self.body_disk_polys[posid] = PosPoly(self._circle_poly_points(2 * self.keepout_radii[posid]['T'], self.config['RESOLUTION_EO'])).translated(x,y)
         self.ferrule_diam = self.config['FERRULE_DIAM']
         self.ferrule_poly = PosPoly(self._circle_poly_points(self.ferrule_diam, self.config['FERRULE_RESLN']))
 
@@ -607,36 +1328,154 @@ class PosCollider(object):
         return [x,y]
 
 
-class PosSweep(object):
+cdef class PosSweep:
     """Contains a real-time description of the sweep of positioner mechanical
     geometries through space.
+
+    Time and (theta,phi) positions are stored internally as contiguous c-arrays
+    of doubles. The properties time, tp, and was_moving_cached return python list
+    copies of these, for convenience. In performance-critical loops, use instead
+    the per-step accessors time_at(), tp_at(), and was_moving().
     """
+    cdef public object posid                # unique posid string of the positioner
+    cdef public object collision_case       # enumeration of type "case", indicating what kind of collision first detected, if any
+    cdef public object collision_time       # time at which collision occurs. if no collision, the time is inf
+    cdef public object collision_idx        # index in time and theta,phi lists at which collision occurs
+    cdef public object collision_neighbor   # id string (posid, 'PTL', or 'GFA') of neighbor it collides with, if any
+    cdef public object frozen_time          # time at which positioner is frozen in place. if no freezing, the time is inf
+    cdef double* _time                      # time at which each TP position value occurs
+    cdef double* _theta                     # theta angles (poslocT coordinates) as function of time
+    cdef double* _phi                       # phi angles (poslocP coordinates) as function of time
+    cdef unsigned char* _moving             # cached boolean values, corresponding to timesteps, as computed by "was_moving() method
+    cdef Py_ssize_t _n                      # number of timesteps stored
+    cdef Py_ssize_t _capacity               # number of timesteps allocated
+
+    def __cinit__(self, posid=None):
+        self._time = NULL
+        self._theta = NULL
+        self._phi = NULL
+        self._moving = NULL
+        self._n = 0
+        self._capacity = 0
+
     def __init__(self, posid=None):
-        self.posid = posid                  # unique posid string of the positioner
-        self.time = []                      # time at which each TP position value occurs
-        self.tp = []                        # theta,phi angles (poslocTP coordinates) as function of time (sign indicates direction)
-        self.was_moving_cached = []         # cached boolean values, corresponding to timesteps, as computed by "was_moving() method
-        self.collision_case = pc.case.I     # enumeration of type "case", indicating what kind of collision first detected, if any
-        self.collision_time = math.inf      # time at which collision occurs. if no collision, the time is inf
-        self.collision_idx = None           # index in time and theta,phi lists at which collision occurs
-        self.collision_neighbor = ''        # id string (posid, 'PTL', or 'GFA') of neighbor it collides with, if any
-        self.frozen_time = math.inf         # time at which positioner is frozen in place. if no freezing, the time is inf
-
-    def copy(self):
-        return copymodule.deepcopy(self)
+        self.posid = posid
+        self.clear_collision()
+        self.frozen_time = math.inf
+
+    def __dealloc__(self):
+        PyMem_Free(self._time)
+        PyMem_Free(self._theta)
+        PyMem_Free(self._phi)
+        PyMem_Free(self._moving)
+
+    def __len__(self):
+        return self._n
+
+    def __reduce__(self):
+        return (_rebuild_sweep, (self.as_dict(),))
+
+    def __copy__(self):
+        return self.copy()
+
+    def __deepcopy__(self, memo):
+        return self.copy()
+
+    cdef int _reserve(self, Py_ssize_t capacity) except -1:
+        """Ensures that the arrays have space for at least capacity timesteps."""
+        cdef double* new_time
+        cdef double* new_theta
+        cdef double* new_phi
+        cdef unsigned char* new_moving
+        if capacity <= self._capacity:
+            return 0
+        capacity = max(capacity, 2 * self._capacity, 16)
+        new_time = <double*> PyMem_Realloc(self._time, capacity * sizeof(double))
+        if new_time:
+            self._time = new_time
+        new_theta = <double*> PyMem_Realloc(self._theta, capacity * sizeof(double))
+        if new_theta:
+            self._theta = new_theta
+        new_phi = <double*> PyMem_Realloc(self._phi, capacity * sizeof(double))
+        if new_phi:
+            self._phi = new_phi
+        new_moving = <unsigned char*> PyMem_Realloc(self._moving, capacity * sizeof(unsigned char))
+        if new_moving:
+            self._moving = new_moving
+        if not new_time or not new_theta or not new_phi or not new_moving:
+            raise MemoryError()
+        self._capacity = capacity
+        return 0
+
+    cdef int _append(self, double time, double theta, double phi) except -1:
+        """Adds a timestep to the end of the sweep, and caches its was_moving value."""
+        cdef Py_ssize_t n = self._n
+        if n >= self._capacity:
+            self._reserve(n + 1)
+        self._time[n] = time
+        self._theta[n] = theta
+        self._phi[n] = phi
+        self._moving[n] = n > 0 and (theta != self._theta[n-1] or phi != self._phi[n-1])
+        self._n = n + 1
+        return 0
+
+    cdef Py_ssize_t _index(self, Py_ssize_t step) except -1:
+        """Converts a (possibly negative) step to an array index."""
+        if step < 0:
+            step += self._n
+        if step < 0 or step >= self._n:
+            raise IndexError(f'PosSweep {self.posid}: step {step} out of range for sweep with {self._n} timesteps')
+        return step
+
+    def _load(self, time, tp):
+        """Replaces all timestep data with the argued lists of times and [theta,phi] pairs."""
+        assert len(time) == len(tp), f'PosSweep {self.posid}: different lengths time ({len(time)}) and tp ({len(tp)})'
+        self._n = 0
+        self._reserve(len(time))
+        for i in range(len(time)):
+            self._append(time[i], tp[i][0], tp[i][1])
+
+    @property
+    def time(self):
+        """List copy of time at which each TP position value occurs."""
+        return [self._time[i] for i in range(self._n)]
+
+    @property
+    def tp(self):
+        """List copy of theta,phi angles (poslocTP coordinates) as function of time."""
+        return [[self._theta[i], self._phi[i]] for i in range(self._n)]
+
+    @property
+    def was_moving_cached(self):
+        """List copy of cached boolean values, corresponding to timesteps, as computed by "was_moving() method."""
+        return [bool(self._moving[i]) for i in range(self._n)]
+
+    cpdef PosSweep copy(self):
+        cdef PosSweep new = PosSweep(self.posid)
+        new._reserve(self._n)
+        memcpy(new._time, self._time, self._n * sizeof(double))
+        memcpy(new._theta, self._theta, self._n * sizeof(double))
+        memcpy(new._phi, self._phi, self._n * sizeof(double))
+        memcpy(new._moving, self._moving, self._n * sizeof(unsigned char))
+        new._n = self._n
+        new.collision_case = self.collision_case
+        new.collision_time = self.collision_time
+        new.collision_idx = self.collision_idx
+        new.collision_neighbor = self.collision_neighbor
+        new.frozen_time = self.frozen_time
+        return new
 
     def as_dict(self):
         """Returns a dictionary containing copies of all the sweep data."""
-        c = self.copy()
-        d = {'posid':               c.posid,
-             'time':                c.time,
-             'tp':                  c.tp,
-             'was_moving':          c.was_moving_cached,
-             'collision_case':      c.collision_case,
-             'collision_time':      c.collision_time,
-             'collision_idx':       c.collision_idx,
-             'collision_neighbor':  c.collision_neighbor,
-             'frozen_time':         c.frozen_time}
+        d = {'posid':               self.posid,
+             'time':                self.time,
+             'tp':                  self.tp,
+             'was_moving':          self.was_moving_cached,
+             'collision_case':      self.collision_case,
+             'collision_time':      self.collision_time,
+             'collision_idx':       self.collision_idx,
+             'collision_neighbor':  self.collision_neighbor,
+             'frozen_time':         self.frozen_time}
         return d
 
     def __repr__(self):
@@ -657,104 +1496,172 @@ class PosSweep(object):
         """Fills in a sweep object based on the input table. Time and position
         are handled continuously and exactly (i.e. not yet quantized).
         """
-        time = [start_time]
-        tp = [list(init_poslocTP)]
-        for i in range(table['nrows']):
-            if table['prepause'][i]:
-                time.append(table['prepause'][i] + time[-1])
-                tp.append(tp[-1].copy())
-            if table['move_time'][i]:
-                time.append(table['move_time'][i] + time[-1])
-                tp.append([table['dT'][i] + tp[-1][0],
-                           table['dP'][i] + tp[-1][1]])
-            if table['postpause'][i]:
-                time.append(table['postpause'][i] + time[-1])
-                tp.append(tp[-1].copy())
-        self.time = time
-        self.tp = tp
-        self.was_moving_cached = [self.was_moving(step) for step in range(len(self.time))]
-
-    def quantize(self, timestep):
+        cdef Py_ssize_t i
+        cdef Py_ssize_t nrows = table['nrows']
+        cdef double t, theta, phi, pause, move_time
+        prepause = table['prepause']
+        move_times = table['move_time']
+        postpause = table['postpause']
+        dT = table['dT']
+        dP = table['dP']
+        self._n = 0
+        self._reserve(3 * nrows + 1)
+        t = start_time
+        theta = init_poslocTP[0]
+        phi = init_poslocTP[1]
+        self._append(t, theta, phi)
+        for i in range(nrows):
+            pause = prepause[i]
+            if pause:
+                t = pause + t
+                self._append(t, theta, phi)
+            move_time = move_times[i]
+            if move_time:
+                t = move_time + t
+                theta = dT[i] + theta
+                phi = dP[i] + phi
+                self._append(t, theta, phi)
+            pause = postpause[i]
+            if pause:
+                t = pause + t
+                self._append(t, theta, phi)
+
+    @cython.cdivision(True)
+    def quantize(self, double timestep):
         """Converts itself from exact, continuous time to quantized, discrete time.
         The result has approximate intermediate (theta,phi) positions and speeds,
         all as a function of discrete time. The quantization is according to the
         parameter 'timestep'.
         """
-        axes = [pc.T,pc.P]
-        discrete_time = [self.time[0]]
-        discrete_position = [self.tp[0].copy()]
-        for i in range(1,len(self.time)):
-            time_diff = self.time[i] - discrete_time[-1]
-            n_steps = int(time_diff / timestep)
-            distance_diffs = [self.tp[i][ax] - self.tp[i-1][ax] for ax in axes]
-            if n_steps == 0 and any(distance_diffs):
+        cdef PosSweep discrete
+        cdef Py_ssize_t i, j, n_steps, last
+        cdef double time_diff, diff_T, diff_P, step_T, step_P
+        if self._n == 0:
+            return
+        discrete = PosSweep(self.posid)
+        discrete._reserve(self._n)
+        discrete._append(self._time[0], self._theta[0], self._phi[0])
+        for i in range(1, self._n):
+            last = discrete._n - 1
+            time_diff = self._time[i] - discrete._time[last]
+            n_steps = <Py_ssize_t>(time_diff / timestep)
+            diff_T = self._theta[i] - self._theta[i-1]
+            diff_P = self._phi[i] - self._phi[i-1]
+            if n_steps == 0 and (diff_T != 0.0 or diff_P != 0.0):
                 n_steps = 1
-            if n_steps:
-                distance_steps = [distance_diffs[ax] / n_steps for ax in axes]
+            if n_steps > 0:
+                step_T = diff_T / n_steps
+                step_P = diff_P / n_steps
+                discrete._reserve(discrete._n + n_steps)
                 for j in range(n_steps):
-                    discrete_time.append(discrete_time[-1] + timestep)
-                    discrete_position.append([discrete_position[-1][ax] + distance_steps[ax] for ax in axes])
-        self.time = discrete_time
-        self.tp = discrete_position
-        self.was_moving_cached = [self.was_moving(step) for step in range(len(self.time))]
-
-    def extend(self, timestep, max_time):
+                    last = discrete._n - 1
+                    discrete._append(discrete._time[last] + timestep,
+                                     discrete._theta[last] + step_T,
+                                     discrete._phi[last] + step_P)
+        self._swap_data(discrete)
+
+    cdef void _swap_data(self, PosSweep other):
+        """Exchanges timestep arrays with another sweep (other keeps the old ones)."""
+        self._time, other._time = other._time, self._time
+        self._theta, other._theta = other._theta, self._theta
+        self._phi, other._phi = other._phi, self._phi
+        self._moving, other._moving = other._moving, self._moving
+        self._n, other._n = other._n, self._n
+        self._capacity, other._capacity = other._capacity, self._capacity
+
+    def extend(self, double timestep, double max_time):
         """Extends a sweep object to max_time to reflect the postpauses inserted into the move table
         in equalize_table_times() in posschedulestage.py, ensuring that the sweep object
         is in sync with the move table so that the animator is reflecting true moves. """
-
-        starttime_extension = self.time[-1] + timestep
+        cdef Py_ssize_t k, n_steps
+        cdef Py_ssize_t last = self._index(-1)
+        cdef double starttime_extension = self._time[last] + timestep
+        cdef double theta = self._theta[last]
+        cdef double phi = self._phi[last]
         n_steps = int((max_time + timestep)/timestep)
-        time_extension = [starttime_extension + k * timestep for k in range(n_steps)]
-        self.time += time_extension
-        tp_extension = [self.tp[-1].copy() for k in range(n_steps)]
-        self.tp += tp_extension
-        self.was_moving_cached += [self.was_moving(step) for step in range(len(self.was_moving_cached),len(self.time))]
+        if n_steps <= 0:
+            return
+        self._reserve(self._n + n_steps)
+        for k in range(n_steps):
+            self._append(starttime_extension + k * timestep, theta, phi)
 
     def register_as_frozen(self):
         """Sets an indicator that the sweep has been frozen at the end."""
-        self.frozen_time = self.time[-1]
+        self.frozen_time = self.time_at(-1)
 
     def clear_collision(self):
         """Resets collision state to default (non-colliding) values."""
-        blank_sample = PosSweep()
-        self.collision_case = blank_sample.collision_case
-        self.collision_time = blank_sample.collision_time
-        self.collision_idx = blank_sample.collision_idx
-        self.collision_neighbor = blank_sample.collision_neighbor
+        self.collision_case = pc.case.I
+        self.collision_time = math.inf
+        self.collision_idx = None
+        self.collision_neighbor = ''
 
     @property
     def is_frozen(self):
         """Returns boolean value whether the sweep has a "freezing" event."""
         return self.frozen_time < math.inf
 
-    def was_moving(self, step):
+    cpdef bint was_moving(self, Py_ssize_t step):
         """Returns boolean value whether the sweep is moving in the most recent
         timestep. 'Most recent' here means the period from (step-1) to step.
         By definition, when step == 0 this function returns False."""
-        if step <= 0 or step >= len(self.tp):
+        if step <= 0 or step >= self._n:
             return False
-        if self.tp[step][0] == self.tp[step-1][0] and self.tp[step][1] == self.tp[step-1][1]:
-            return False
-        return True
+        return self._moving[step]
 
-    def axis_was_moving(self, step, axis):
-        '''Like was_moving, but for axis = 0 (means theta) or 1 (means phi).
-        Separately defined from was_moving, to avoid some overhead when that
-        function is repeatedly called during anticollision calcs.'''
-        if step <= 0 or step >= len(self.tp):
-            return False
-        if self.tp[step][axis] == self.tp[step-1][axis]:
+    cpdef bint axis_was_moving(self, Py_ssize_t step, int axis):
+        '''Like was_moving, but for axis = 0 (means theta) or 1 (means phi).'''
+        if step <= 0 or step >= self._n:
             return False
-        return True
-
-    def theta(self, step):
+        if axis == 0:
+            return self._theta[step] != self._theta[step-1]
+        return self._phi[step] != self._phi[step-1]
+
+    cpdef double time_at(self, Py_ssize_t step) except? -1:
+        """Returns time of the sweep at the specified timestep index."""
+        return self._time[self._index(step)]
+
+    cpdef list tp_at(self, Py_ssize_t step):
+        """Returns [theta,phi] position of the sweep at the specified timestep index."""
+        step = self._index(step)
+        return [self._theta[step], self._phi[step]]
+
+    cpdef Py_ssize_t step_at_time(self, double time) except -1:
+        """Returns index of the first timestep at or after the argued time. If time
+        is beyond the end of the sweep, returns the last index.
+        """
+        cdef Py_ssize_t lo = 0
+        cdef Py_ssize_t hi = self._index(-1)
+        cdef Py_ssize_t mid
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if self._time[mid] < time:
+                lo = mid + 1
+            else:
+                hi = mid
+        return lo
+
+    @cython.cdivision(True)
+    cpdef list tp_at_time(self, double time):
+        """Returns [theta,phi] position of the sweep at an arbitrary time, linearly
+        interpolating between timesteps. Before the start of the sweep, returns the
+        start position. After the end of the sweep, returns the final position.
+        """
+        cdef Py_ssize_t i = self.step_at_time(time)
+        cdef double f
+        if i == 0 or time >= self._time[i]:
+            return [self._theta[i], self._phi[i]]
+        f = (time - self._time[i-1]) / (self._time[i] - self._time[i-1])
+        return [self._theta[i-1] + f * (self._theta[i] - self._theta[i-1]),
+                self._phi[i-1] + f * (self._phi[i] - self._phi[i-1])]
+
+    cpdef double theta(self, Py_ssize_t step) except? -1:
         """Returns theta position of the sweep at the specified timestep index."""
-        return self.tp[step][0]
+        return self._theta[self._index(step)]
 
-    def phi(self, step):
+    cpdef double phi(self, Py_ssize_t step) except? -1:
         """Returns phi position of the sweep at the specified timestep index."""
-        return self.tp[step][1]
+        return self._phi[self._index(step)]
 
     def check_continuity(self, stepsize, posmodel):
         """Checks that no abs delta theta or abs delta phi is greater than
@@ -767,26 +1674,94 @@ class PosSweep(object):
         these do in fact represent an enormous discontinuity (due to theta
         hardstop).
         """
-        L = len(self.tp)
+        L = self._n
         if L < 2:
             return True
-        posintTP = [posmodel.trans.poslocTP_to_posintTP(self.tp[i]) for i in range(0,L)]
+        tp = self.tp
+        posintTP = [posmodel.trans.poslocTP_to_posintTP(tp[i]) for i in range(0,L)]
         abs_delta_t = [abs(posintTP[i][0] - posintTP[i-1][0]) for i in range(1,L)]
         abs_delta_p = [abs(posintTP[i][1] - posintTP[i-1][1]) for i in range(1,L)]
         if max(abs_delta_t) > stepsize or max(abs_delta_p) > stepsize:
             return False
         return True
 
-from cpython.mem cimport PyMem_Malloc, PyMem_Free
+def _rebuild_sweep(d):
+    """Reconstructs a PosSweep from the output of its as_dict() method (used for pickling)."""
+    sweep = PosSweep(d['posid'])
+    sweep._load(d['time'], d['tp'])
+    for key in ['collision_case', 'collision_time', 'collision_idx', 'collision_neighbor', 'frozen_time']:
+        setattr(sweep, key, d[key])
+    return sweep
+
+from cpython.mem cimport PyMem_Malloc, PyMem_Realloc, PyMem_Free
+from libc.string cimport memcpy
 from libc.math cimport sin as c_sin
 from libc.math cimport cos as c_cos
 from libc.math cimport pi as c_pi
 from libc.math cimport fmax as c_fmax
 from libc.math cimport fmin as c_fmin
 from libc.math cimport atan2 as c_atan2
+from libc.math cimport sqrt as c_sqrt
+from libc.math cimport asin as c_asin
+from libc.math cimport ceil as c_ceil
+from libc.math cimport floor as c_floor
+from libc.math cimport INFINITY
+from libc.math cimport NAN
+from libc.math cimport nearbyint as c_nearbyint
 cdef double rad_per_deg = c_pi / 180.0
 cdef double deg_per_rad = 180.0 / c_pi
 
+# Inputs to _sweeps_collide_c(), for checking quantized sweeps without the GIL (see
+# PosCollider._quantized_collision). Pointers are borrowed from the PosSweep and
+# PosPoly objects, except for the placed polygon buffers, which the caller allocates.
+cdef struct _SweepGeom:
+    double* theta               # quantized sweep, poslocT at each step
+    double* phi                 # quantized sweep, poslocP at each step
+    unsigned char* moving       # quantized sweep, was_moving() at each step
+    Py_ssize_t n                # number of steps in the sweep
+    double* arm_x               # phi arm keepout, unplaced
+    double* arm_y
+    unsigned int n_arm
+    double* body_x              # central body keepout, unplaced
+    double* body_y
+    unsigned int n_body
+    double x0, y0, r1           # positioner calibration values
+    bint retracted              # whether positioner is classified as retracted
+    double* placed_arm_x        # phi arm keepout, as most recently placed
+    double* placed_arm_y
+    double* placed_body_x       # central body keepout, as most recently placed
+    double* placed_body_y
+    double arm_t, arm_p, body_t # (rounded) angles of the placed polygons. NAN --> not placed yet
+
+cdef struct _PairGrid:
+    const unsigned char* cells  # see PosPairLookup
+    double d_min, d_step, t_step, p_min, p_step
+    int n_d, n_t, n_p
+    long long n_s               # number of (theta, phi) states of one positioner, n_t * n_p
+
+cdef struct _FixedGrid:
+    const unsigned char* cells  # see PosFixedLookup
+    double t_step, p_min, p_step
+    int n_t, n_p
+
+cdef struct _CheckContext:
+    double Eo_phi, Ei_phi       # see PosCollider._load_circle_envelopes
+    double Eo_radius            # PosCollider.Eo_radius_with_margin
+    double quantum              # PosCollider.placement_cache_quantum
+    unsigned int kernel         # polygon kernel, 0 --> reference, 1 --> batched
+    _PairGrid* grid             # pos-pos lookup table. NULL --> none
+    bint pair_applies           # whether the lookup table applies to this pair of positioners
+    double pair_distance        # center-to-center distance of the pair
+    double pair_bearing         # bearing angle of B from A
+    long n_clear, n_colliding, n_fallback, n_not_applicable  # lookup counts, as in PosCollider.pair_lookup_counts (or fixed_lookup_counts)
+    _FixedGrid* fixed_grid      # pos-fixed lookup table. NULL --> none
+    int fixed_loc               # index of the (pos-fixed) positioner on the table's location axis. -1 --> table does not apply
+    int n_fixed                 # number of fixed keepouts neighboring the (pos-fixed) positioner
+    int fixed_case[2]
+    double* fixed_x[2]
+    double* fixed_y[2]
+    unsigned int fixed_n[2]
+
 cdef class PosPoly:
     """Represents a collidable polygonal envelope definition for a mechanical component
     of the fiber positioner.
@@ -877,16 +1852,7 @@ cdef class PosPoly:
     cpdef PosPoly rotated(self, angle):
         """Returns a copy of the polygon object, with points rotated by angle (unit degrees)."""
         cdef PosPoly new = self.copy()
-        cdef double a = angle
-        a *= rad_per_deg
-        cdef double c = c_cos(a)
-        cdef double s = c_sin(a)
-        cdef double this_x
-        cdef unsigned int i
-        for i in range(new.n_pts):
-            this_x = new.x[i]
-            new.x[i] = c*this_x + -s*new.y[i]
-            new.y[i] = s*this_x +  c*new.y[i]
+        _rotate_points(new.x, new.y, new.n_pts, angle, new.x, new.y)
         return new
 
     cpdef PosPoly translated(self, dx, dy):
@@ -960,31 +1926,16 @@ cdef class PosPoly:
         """Treating polygon as a phi arm, rotates and translates it to position defined
         by angles theta and phi (deg) and calibration values x0, y0, r1.
         """
-        cdef PosPoly new = self.rotated(theta + phi) # units deg
-        cdef double X0 = x0
-        cdef double Y0 = y0
-        cdef double R1 = r1
-        cdef double T = theta
-        cdef unsigned int i
-        T *= rad_per_deg
-        cdef double delta_x = X0 + R1 * c_cos(T) # now radians
-        cdef double delta_y = Y0 + R1 * c_sin(T)
-        for i in range(new.n_pts):
-            new.x[i] += delta_x
-            new.y[i] += delta_y
+        cdef PosPoly new = PosPoly(points=0, close_polygon=False, allocation=self.n_pts)
+        _place_phi_arm_points(self.x, self.y, self.n_pts, theta, phi, x0, y0, r1, new.x, new.y)
         return new
 
     cpdef PosPoly place_as_central_body(self, theta, x0, y0):
         """Treating polygon as a central body, rotates and translates it to postion
         defined by angle theta (deg) and calibration values x0, y0.
         """
-        cdef PosPoly new = self.rotated(theta)
-        cdef double delta_x = x0
-        cdef double delta_y = y0
-        cdef unsigned int i
-        for i in range(new.n_pts):
-            new.x[i] += delta_x
-            new.y[i] += delta_y
+        cdef PosPoly new = PosPoly(points=0, close_polygon=False, allocation=self.n_pts)
+        _place_central_body_points(self.x, self.y, self.n_pts, theta, x0, y0, new.x, new.y)
         return new
 
     cpdef unsigned int collides_with(self, PosPoly other):
@@ -992,28 +1943,85 @@ cdef class PosPoly:
         another PosPoly object. Returns a bool, where true indicates a
         collision.
         """
+        cdef unsigned int result
         if _bounding_boxes_collide(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts):
-            return _polygons_collide(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts)
+            if _release_gil and _polygon_kernel == 1:
+                with nogil:
+                    result = _polygons_collide_batched(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts)
+                return result
+            return _polygons_collide_selected(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts)
         else:
             return False
 
-    cpdef unsigned int collides_with_circle(self, x, y, radius):
-        """Searches for collisions in space between this polygon and
-        a circle, defined by center (x,y) and radius. Returns a bool,
-        where true indicates a collision.
+    cpdef double max_deviation_from(self, PosPoly other, double dx):
+        """Returns the maximum distance between corresponding vertices of this polygon
+        (shifted by dx along the x-axis) and another polygon. Returns infinity if the
+        two polygons do not have the same number of vertices.
+        """
+        cdef unsigned int i
+        cdef double dev = 0.0
+        if self.n_pts != other.n_pts:
+            return INFINITY
+        for i in range(self.n_pts):
+            dev = c_fmax(dev, c_sqrt((self.x[i] + dx - other.x[i])**2 + (self.y[i] - other.y[i])**2))
+        return dev
+
+    cpdef unsigned int overlaps(self, PosPoly other):
+        """Like collides_with(), but also returns True when one polygon entirely
+        encloses the other.
+        """
+        if not _bounding_boxes_collide(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts):
+            return False
+        if _polygons_collide_selected(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts):
+            return True
+        if _point_in_polygon(self.x[0], self.y[0], other.x, other.y, other.n_pts):
+            return True
+        return _point_in_polygon(other.x[0], other.y[0], self.x, self.y, self.n_pts)
+
+    cpdef double distance_to(self, PosPoly other):
+        """Returns a lower bound on the distance between this polygon and another
+        PosPoly object, consistent with collides_with(). I.e. 0.0 if they collide.
+        When the bounding boxes of the polygons are separated, the gap between the
+        boxes is returned (which is cheap, and a lower bound on the true distance).
+        Otherwise the minimum vertex-to-edge distance is calculated exactly.
+        """
+        cdef double gap = _bounding_boxes_gap(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts)
+        if gap > 0.0:
+            return gap
+        return _polygons_distance(self.x, self.y, self.n_pts, other.x, other.y, other.n_pts)
+
+    cpdef double distance_to_circle(self, x, y, radius):
+        """Returns the minimum distance from any vertex of this polygon to a circle
+        defined by center (x,y) and radius, consistent with collides_with_circle().
+        Values <= 0 indicate collision.
         """
         cdef double X = x
         cdef double Y = y
         cdef double R = radius
         cdef double distance
+        cdef double min_distance = INFINITY
         cdef unsigned int i
         for i in range(self.n_pts):
-            distance = ((self.x[i] - X)**2 + (self.y[i] - Y)**2)**0.5
-            if distance < R:
-                return True
-        return False
+            distance = c_sqrt((self.x[i] - X)**2 + (self.y[i] - Y)**2)
+            min_distance = c_fmin(distance, min_distance)
+        return min_distance - R
 
-cdef unsigned int _bounding_boxes_collide(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2):
+    cpdef double max_radius(self):
+        """Returns the greatest distance of any vertex from the polygon's [0,0] center."""
+        cdef double max_r2 = 0.0
+        cdef unsigned int i
+        for i in range(self.n_pts):
+            max_r2 = c_fmax(self.x[i]**2 + self.y[i]**2, max_r2)
+        return c_sqrt(max_r2)
+
+    cpdef unsigned int collides_with_circle(self, x, y, radius):
+        """Searches for collisions in space between this polygon and
+        a circle, defined by center (x,y) and radius. Returns a bool,
+        where true indicates a collision.
+        """
+        return _points_within_circle(self.x, self.y, self.n_pts, x, y, radius)
+
+cdef unsigned int _bounding_boxes_collide(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2) noexcept nogil:
     """Check whether the rectangular bounding boxes of two polygons collide.
 
        x1,y1 ... 1xN c-arrays of the 1st polygon's vertices
@@ -1034,7 +2042,151 @@ cdef unsigned int _bounding_boxes_collide(double x1[], double y1[], unsigned int
     else:
         return True
 
-cdef unsigned int _polygons_collide(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2):
+cdef double _bounding_boxes_gap(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2):
+    """Distance between the rectangular bounding boxes of two polygons (0.0 if they
+    overlap). Arguments are as in _bounding_boxes_collide().
+    """
+    cdef double gap_x = c_fmax(_c_min(x2,len2) - _c_max(x1,len1), _c_min(x1,len1) - _c_max(x2,len2))
+    cdef double gap_y = c_fmax(_c_min(y2,len2) - _c_max(y1,len1), _c_min(y1,len1) - _c_max(y2,len2))
+    gap_x = c_fmax(gap_x, 0.0)
+    gap_y = c_fmax(gap_y, 0.0)
+    return c_sqrt(gap_x**2 + gap_y**2)
+
+cdef double _polygons_distance(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2):
+    """Minimum distance between the edges of two polygons. Returns 0.0 if they
+    collide (as defined by _polygons_collide). Arguments are as in _polygons_collide().
+    """
+    cdef double min_distance = INFINITY
+    cdef unsigned int i, j
+    if _polygons_collide_selected(x1, y1, len1, x2, y2, len2):
+        return 0.0
+    for i in range(len1):
+        for j in range(len2 - 1):
+            min_distance = c_fmin(_point_segment_distance(x1[i], y1[i], x2[j], y2[j], x2[j+1], y2[j+1]), min_distance)
+    for j in range(len2):
+        for i in range(len1 - 1):
+            min_distance = c_fmin(_point_segment_distance(x2[j], y2[j], x1[i], y1[i], x1[i+1], y1[i+1]), min_distance)
+    return min_distance
+
+@cython.cdivision(True)
+cdef unsigned int _point_in_polygon(double px, double py, double x[], double y[], unsigned int length):
+    """Even-odd rule test whether point P is inside a closed polygon."""
+    cdef unsigned int i
+    cdef unsigned int inside = False
+    for i in range(length - 1):
+        if (y[i] > py) != (y[i+1] > py):
+            if px < x[i] + (py - y[i]) * (x[i+1] - x[i]) / (y[i+1] - y[i]):
+                inside = not inside
+    return inside
+
+cdef double _phi_arm_envelope_sample_step = 1.0 # deg, phi sampling interval when bounding the phi arm's swept region
+cdef double _envelope_margin = 1e-6 # mm, extra margin added to sweep envelopes, to cover roundoff
+
+@cython.cdivision(True)
+cdef PosPoly _phi_arm_envelope(PosPoly keepout, double r1, double t_min, double t_max,
+                               double p_min, double p_max, double x0, double y0, unsigned int resolution):
+    """Returns a polygon containing every placement of the phi arm keepout, for any
+    (theta,phi) within ranges [t_min,t_max] and [p_min,p_max] (deg). The polygon is
+    an annular sector (or a disk) about the positioner center (x0,y0).
+
+    Phi is sampled at steps <= _phi_arm_envelope_sample_step. Between samples, no
+    point on the arm can move further than m = (max keepout radius) * (step / 2),
+    so the radial and angular bounds found from the samples are widened to cover m.
+    At each sample, radial bounds come from the arm's edges, and angular bounds from
+    its vertices. If the arm ever covers (or nearly covers) the center, then its
+    angles are unbounded, and a disk of the arm's maximum reach is returned.
+    """
+    cdef unsigned int n_samples, k, i
+    cdef double step, phi, c, s, m, da, span, delta, r_outer, a, a_ref
+    cdef double r_min = INFINITY
+    cdef double r_max = 0.0
+    cdef double a_min = INFINITY
+    cdef double a_max = -INFINITY
+    cdef double s_min, s_max, shift, y_cross
+    cdef unsigned int full = False
+    cdef unsigned int crosses_neg, crosses_pos
+    cdef PosPoly arm = keepout.copy()
+    n_samples = <unsigned int>c_ceil((p_max - p_min) / _phi_arm_envelope_sample_step) + 1
+    step = (p_max - p_min) / (n_samples - 1) if n_samples > 1 else 0.0
+    for k in range(n_samples):
+        phi = (p_min + k * step) * rad_per_deg
+        c = c_cos(phi)
+        s = c_sin(phi)
+        for i in range(arm.n_pts):
+            arm.x[i] = r1 + c * keepout.x[i] - s * keepout.y[i]
+            arm.y[i] = s * keepout.x[i] + c * keepout.y[i]
+        if _point_in_polygon(0.0, 0.0, arm.x, arm.y, arm.n_pts):
+            full = True
+            break
+        for i in range(arm.n_pts - 1):
+            r_min = c_fmin(_point_segment_distance(0.0, 0.0, arm.x[i], arm.y[i], arm.x[i+1], arm.y[i+1]), r_min)
+        r_max = c_fmax(arm.max_radius(), r_max)
+        # angular extent of this sample, unwrapped across whichever x-axis ray the polygon does not cross
+        crosses_neg = False
+        crosses_pos = False
+        for i in range(arm.n_pts - 1):
+            if (arm.y[i] >= 0.0) != (arm.y[i+1] >= 0.0):
+                y_cross = arm.x[i] + (0.0 - arm.y[i]) * (arm.x[i+1] - arm.x[i]) / (arm.y[i+1] - arm.y[i])
+                if y_cross < 0.0:
+                    crosses_neg = True
+                else:
+                    crosses_pos = True
+        if crosses_neg and crosses_pos:
+            full = True
+            break
+        s_min = INFINITY
+        s_max = -INFINITY
+        for i in range(arm.n_pts):
+            a = c_atan2(arm.y[i], arm.x[i]) * deg_per_rad
+            if crosses_neg and a < 0.0:
+                a += 360.0
+            s_min = c_fmin(a, s_min)
+            s_max = c_fmax(a, s_max)
+        # shift by whole turns, to be continuous with the samples so far
+        if k > 0:
+            a_ref = (a_min + a_max) / 2
+            shift = 360.0 * c_floor(((s_min + s_max) / 2 - a_ref + 180.0) / 360.0)
+            s_min -= shift
+            s_max -= shift
+        a_min = c_fmin(s_min, a_min)
+        a_max = c_fmax(s_max, a_max)
+    m = keepout.max_radius() * (step / 2) * rad_per_deg + _envelope_margin
+    r_max += m
+    r_min -= m
+    if not full:
+        if r_min <= m:
+            full = True
+        else:
+            da = c_asin(m / r_min) * deg_per_rad
+            a_min = a_min + t_min - da
+            a_max = a_max + t_max + da
+            span = a_max - a_min
+            if span >= 360.0:
+                full = True
+    if full:
+        r_max = r1 + keepout.max_radius() + _envelope_margin # samples may have been cut short, so use the overall bound
+        return PosPoly(PosCollider._circle_poly_points(2 * r_max, resolution)).translated(x0, y0)
+    n_segments = <unsigned int>c_ceil(span / 10.0) + 1
+    delta = span / n_segments
+    r_outer = r_max / c_cos(delta / 2 * rad_per_deg)
+    outer_angles = [(a_min + i * delta) * rad_per_deg for i in range(n_segments + 1)]
+    xs = [x0 + r_outer * c_cos(a) for a in outer_angles] + [x0 + r_min * c_cos(a) for a in reversed(outer_angles)]
+    ys = [y0 + r_outer * c_sin(a) for a in outer_angles] + [y0 + r_min * c_sin(a) for a in reversed(outer_angles)]
+    return PosPoly([xs, ys])
+
+@cython.cdivision(True)
+cdef double _point_segment_distance(double px, double py, double ax, double ay, double bx, double by):
+    """Distance from point P to the line segment from A to B."""
+    cdef double dx = bx - ax
+    cdef double dy = by - ay
+    cdef double length2 = dx*dx + dy*dy
+    cdef double f = 0.0
+    if length2 > 0.0:
+        f = ((px - ax)*dx + (py - ay)*dy) / length2
+        f = c_fmin(c_fmax(f, 0.0), 1.0)
+    return c_sqrt((ax + f*dx - px)**2 + (ay + f*dy - py)**2)
+
+cdef unsigned int _polygons_collide(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2) noexcept nogil:
     """Check whether two closed polygons collide.
 
        x1,y1 ... 1xN c-arrays of the 1st polygon's vertices
@@ -1060,8 +2212,125 @@ cdef unsigned int _polygons_collide(double x1[], double y1[], unsigned int len1,
                 return True
     return False
 
+# Selection of the polygon-polygon collision kernel used by PosPoly.collides_with().
+#   'reference' ... scalar _polygons_collide(), one edge pair at a time
+#   'batched'   ... _polygons_collide_batched(), one edge against a block of edges
+#   'compare'   ... runs both, returns the reference answer, and counts disagreements
+# The batched kernel performs exactly the same floating point operations as the
+# reference, so the two should never disagree. The 'compare' mode is there to
+# demonstrate that on any given machine / compiler, at the cost of speed.
+polygon_kernel_modes = ('reference', 'batched', 'compare')
+cdef unsigned int _polygon_kernel = 1
+cdef unsigned long _polygon_kernel_n_compared = 0
+cdef unsigned long _polygon_kernel_n_mismatched = 0
+cdef unsigned int _release_gil = 0 # count of active PosCollider.releasing_gil() contexts (i.e. checking in threads), shared by all PosCollider instances in the process
+cdef enum:
+    _CASE_I = 0         # same values as pc.case
+    _CASE_II = 1
+    _CASE_III = 2
+    _CASE_IV = 3
+assert (pc.case.I, pc.case.II, pc.case.III, pc.case.IV) == (_CASE_I, _CASE_II, _CASE_III, _CASE_IV)
+cdef enum:
+    _EDGE_BLOCK = 16  # number of polygon 2 edges tested per pass of the batched kernel
+
+def set_polygon_kernel(mode):
+    """Select which polygon collision kernel PosPoly.collides_with() uses. Valid
+    modes are listed in polygon_kernel_modes. Resets the comparison counters.
+    """
+    global _polygon_kernel
+    assert mode in polygon_kernel_modes, f'poscollider: invalid polygon kernel mode {mode}. Must be one of {polygon_kernel_modes}'
+    _polygon_kernel = polygon_kernel_modes.index(mode)
+    reset_polygon_kernel_stats()
+
+def get_polygon_kernel():
+    """Returns name of the currently selected polygon collision kernel."""
+    return polygon_kernel_modes[_polygon_kernel]
+
+def polygon_kernel_stats():
+    """Returns dict of counts from 'compare' mode, i.e. how many polygon pairs
+    were checked with both kernels, and how many times the kernels disagreed.
+    """
+    return {'mode': get_polygon_kernel(),
+            'num compared': _polygon_kernel_n_compared,
+            'num mismatched': _polygon_kernel_n_mismatched}
+
+def reset_polygon_kernel_stats():
+    global _polygon_kernel_n_compared, _polygon_kernel_n_mismatched
+    _polygon_kernel_n_compared = 0
+    _polygon_kernel_n_mismatched = 0
+
+cdef unsigned int _polygons_collide_selected(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2):
+    """Dispatches to the polygon collision kernel selected by set_polygon_kernel()."""
+    global _polygon_kernel_n_compared, _polygon_kernel_n_mismatched
+    cdef unsigned int reference
+    cdef unsigned int batched
+    if _polygon_kernel == 1:
+        return _polygons_collide_batched(x1, y1, len1, x2, y2, len2)
+    reference = _polygons_collide(x1, y1, len1, x2, y2, len2)
+    if _polygon_kernel == 2:
+        batched = _polygons_collide_batched(x1, y1, len1, x2, y2, len2)
+        _polygon_kernel_n_compared += 1
+        if batched != reference:
+            _polygon_kernel_n_mismatched += 1
+            pc.printfunc(f'poscollider: polygon kernel mismatch (reference={reference}, batched={batched}) ' +
+                         f'for polygons {_c_points(x1, y1, len1)} and {_c_points(x2, y2, len2)}')
+    return reference
+
+cdef unsigned int _polygons_collide_batched(double x1[], double y1[], unsigned int len1, double x2[], double y2[], unsigned int len2) noexcept nogil:
+    """Same inputs, outputs, and caveats as _polygons_collide().
+
+    Rather than stepping through edge pairs one at a time, each edge of polygon 1
+    is tested against a block of polygon 2's edges in a single branch-free pass
+    over the x2 and y2 arrays. The arithmetic is identical to _segments_intersect().
+    Exits early at the end of any block containing an intersection.
+    """
+    cdef unsigned int i, start, stop
+    cdef unsigned int n_edges2
+    if len2 < 2:
+        return False
+    n_edges2 = len2 - 1
+    for i in range(len1 - 1):
+        start = 0
+        while start < n_edges2:
+            stop = start + _EDGE_BLOCK
+            if stop > n_edges2:
+                stop = n_edges2
+            if _edge_hits_edges(x1[i], y1[i], x1[i+1], y1[i+1], x2, y2, start, stop):
+                return True
+            start = stop
+    return False
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
 @cython.cdivision(True)
-cdef unsigned int _segments_intersect(double A1[2], double A2[2], double B1[2], double B2[2]):
+cdef unsigned int _edge_hits_edges(double ax1, double ay1, double ax2, double ay2, double* x2, double* y2, unsigned int start, unsigned int stop) noexcept nogil:
+    """Checks whether segment A, from (ax1,ay1) to (ax2,ay2), intersects any of the
+    polygon edges (x2[j],y2[j]) --> (x2[j+1],y2[j+1]), for j in [start,stop).
+
+    The loop body has no branches (parallel edges are masked rather than skipped,
+    and divisions by zero just produce non-finite values that fail the range tests),
+    so the compiler is free to vectorize it across j.
+    """
+    cdef double dx_A = ax2 - ax1
+    cdef double dy_A = ay2 - ay1
+    cdef double dx_B, dy_B, delta, s, t
+    cdef unsigned int j
+    cdef unsigned int hits = 0
+    for j in range(start, stop):
+        dx_B = x2[j+1] - x2[j]
+        dy_B = y2[j+1] - y2[j]
+        delta = dx_B * dy_A - dy_B * dx_A
+        s = (dx_A * (y2[j] - ay1) + dy_A * (ax1 - x2[j])) / delta
+        t = (dx_B * (ay1 - y2[j]) + dy_B * (x2[j] - ax1)) / (-delta)
+        hits |= (delta != 0.0) & (s >= 0.0) & (s <= 1.0) & (t >= 0.0) & (t <= 1.0)
+    return hits
+
+cdef object _c_points(double x[], double y[], unsigned int length):
+    """Python list [[x...],[y...]] copy of c-array polygon vertices, for printouts."""
+    return [[x[i] for i in range(length)], [y[i] for i in range(length)]]
+
+@cython.cdivision(True)
+cdef unsigned int _segments_intersect(double A1[2], double A2[2], double B1[2], double B2[2]) noexcept nogil:
     """Checks whether two 2d line segments intersect. The endpoints for segments
     A and B are each a pair of (x,y) coordinates.
     """
@@ -1076,7 +2345,7 @@ cdef unsigned int _segments_intersect(double A1[2], double A2[2], double B1[2],
     t = (dx_B * (A1[1] - B1[1]) + dy_B * (B1[0] - A1[0])) / (-delta)
     return (0 <= s <= 1) and (0 <= t <= 1)
 
-cdef double _c_max(double x[], unsigned int length):
+cdef double _c_max(double x[], unsigned int length) noexcept nogil:
     """Get the max of a c-array of doubles."""
     cdef unsigned int i
     cdef double max_val
@@ -1088,7 +2357,7 @@ cdef double _c_max(double x[], unsigned int length):
     else:
         return 0.0
 
-cdef double _c_min(double x[], unsigned int length):
+cdef double _c_min(double x[], unsigned int length) noexcept nogil:
     """Get the min of a c-array of doubles."""
     cdef unsigned int i
     cdef double min_val
@@ -1100,6 +2369,204 @@ cdef double _c_min(double x[], unsigned int length):
     else:
         return 0.0
 
+cdef void _rotate_points(double* x, double* y, unsigned int n, double angle, double* out_x, double* out_y) noexcept nogil:
+    """Writes the points (x,y), rotated by angle (deg) about [0,0], into out_x and out_y
+    (which may be the same arrays as x and y).
+    """
+    cdef double a = angle * rad_per_deg
+    cdef double c = c_cos(a)
+    cdef double s = c_sin(a)
+    cdef double this_x
+    cdef unsigned int i
+    for i in range(n):
+        this_x = x[i]
+        out_x[i] = c*this_x + -s*y[i]
+        out_y[i] = s*this_x +  c*y[i]
+
+cdef void _place_phi_arm_points(double* x, double* y, unsigned int n, double theta, double phi,
+                                double x0, double y0, double r1, double* out_x, double* out_y) noexcept nogil:
+    """Points of PosPoly.place_as_phi_arm(), written into out_x and out_y."""
+    cdef double T = theta * rad_per_deg
+    cdef double delta_x = x0 + r1 * c_cos(T)
+    cdef double delta_y = y0 + r1 * c_sin(T)
+    cdef unsigned int i
+    _rotate_points(x, y, n, theta + phi, out_x, out_y)
+    for i in range(n):
+        out_x[i] += delta_x
+        out_y[i] += delta_y
+
+cdef void _place_central_body_points(double* x, double* y, unsigned int n, double theta,
+                                     double x0, double y0, double* out_x, double* out_y) noexcept nogil:
+    """Points of PosPoly.place_as_central_body(), written into out_x and out_y."""
+    cdef unsigned int i
+    _rotate_points(x, y, n, theta, out_x, out_y)
+    for i in range(n):
+        out_x[i] += x0
+        out_y[i] += y0
+
+cdef unsigned int _points_within_circle(double* x, double* y, unsigned int n, double X, double Y, double R) noexcept nogil:
+    """Whether any of the points (x,y) is within the circle of radius R about (X,Y)."""
+    cdef double distance
+    cdef unsigned int i
+    for i in range(n):
+        distance = ((x[i] - X)**2 + (y[i] - Y)**2)**0.5
+        if distance < R:
+            return True
+    return False
+
+cdef unsigned int _collide_c(unsigned int kernel, double* x1, double* y1, unsigned int len1,
+                             double* x2, double* y2, unsigned int len2) noexcept nogil:
+    """Same as PosPoly.collides_with(), for polygon kernel 0 (reference) or 1 (batched)."""
+    if not _bounding_boxes_collide(x1, y1, len1, x2, y2, len2):
+        return False
+    if kernel == 1:
+        return _polygons_collide_batched(x1, y1, len1, x2, y2, len2)
+    return _polygons_collide(x1, y1, len1, x2, y2, len2)
+
+@cython.cdivision(True)
+cdef inline double _rounded_angle(double angle, double quantum) noexcept nogil:
+    """Same value as round(angle / quantum) * quantum in python. Adding 0.0 turns
+    -0.0 into 0.0, as the python int would.
+    """
+    return (c_nearbyint(angle / quantum) + 0.0) * quantum
+
+cdef void _place_arm_c(_CheckContext* ctx, _SweepGeom* g, double theta, double phi) noexcept nogil:
+    """Places the phi arm into g's buffer, as PosCollider.place_phi_arm() would."""
+    cdef double t = _rounded_angle(theta, ctx.quantum)
+    cdef double p = _rounded_angle(phi, ctx.quantum)
+    if t != g.arm_t or p != g.arm_p:
+        _place_phi_arm_points(g.arm_x, g.arm_y, g.n_arm, t, p, g.x0, g.y0, g.r1, g.placed_arm_x, g.placed_arm_y)
+        g.arm_t = t
+        g.arm_p = p
+
+cdef void _place_body_c(_CheckContext* ctx, _SweepGeom* g, double theta) noexcept nogil:
+    """Places the central body into g's buffer, as PosCollider.place_central_body() would."""
+    cdef double t = _rounded_angle(theta, ctx.quantum)
+    if t != g.body_t:
+        _place_central_body_points(g.body_x, g.body_y, g.n_body, t, g.x0, g.y0, g.placed_body_x, g.placed_body_y)
+        g.body_t = t
+
+cdef unsigned int _arm_hits_body_c(_CheckContext* ctx, _SweepGeom* g1, Py_ssize_t s1, _SweepGeom* g2, Py_ssize_t s2) noexcept nogil:
+    """Same as PosCollider._case_III_collision()."""
+    _place_arm_c(ctx, g1, g1.theta[s1], g1.phi[s1])
+    _place_body_c(ctx, g2, g2.theta[s2])
+    return _collide_c(ctx.kernel, g1.placed_arm_x, g1.placed_arm_y, g1.n_arm, g2.placed_body_x, g2.placed_body_y, g2.n_body)
+
+cdef unsigned int _arm_hits_circle_c(_CheckContext* ctx, _SweepGeom* g1, Py_ssize_t s1, _SweepGeom* g2) noexcept nogil:
+    """Same as PosCollider._case_IV_collision()."""
+    _place_arm_c(ctx, g1, g1.theta[s1], g1.phi[s1])
+    return _points_within_circle(g1.placed_arm_x, g1.placed_arm_y, g1.n_arm, g2.x0, g2.y0, ctx.Eo_radius)
+
+cdef int _spatial_pair_c(_CheckContext* ctx, _SweepGeom* A, Py_ssize_t sA, _SweepGeom* B, Py_ssize_t sB) noexcept nogil:
+    """Same as PosCollider.spatial_collision_between_positioners(), at step sA of
+    sweep A and step sB of sweep B.
+    """
+    cdef double pA = A.phi[sA]
+    cdef double pB = B.phi[sB]
+    cdef bint A_is_within_Eo = pA >= ctx.Eo_phi or A.retracted
+    cdef bint B_is_within_Eo = pB >= ctx.Eo_phi or B.retracted
+    cdef int cell
+    if A_is_within_Eo and B_is_within_Eo:
+        return _CASE_I
+    elif not A_is_within_Eo and B.retracted:
+        return _CASE_IV if _arm_hits_circle_c(ctx, A, sA, B) else _CASE_I
+    elif not B_is_within_Eo and A.retracted:
+        return _CASE_IV if _arm_hits_circle_c(ctx, B, sB, A) else _CASE_I
+    elif pA < ctx.Eo_phi and pB >= ctx.Ei_phi:
+        return _CASE_III if _arm_hits_body_c(ctx, A, sA, B, sB) else _CASE_I
+    elif pB < ctx.Eo_phi and pA >= ctx.Ei_phi:
+        return _CASE_III if _arm_hits_body_c(ctx, B, sB, A, sA) else _CASE_I
+    if ctx.grid != NULL:
+        if not ctx.pair_applies:
+            ctx.n_not_applicable += 1
+        else:
+            cell = _pair_cell(ctx.grid, ctx.pair_distance, A.theta[sA] - ctx.pair_bearing, pA, B.theta[sB] - ctx.pair_bearing, pB)
+            if cell == _CELL_CLEAR:
+                ctx.n_clear += 1
+                return _CASE_I
+            elif cell == _CELL_UNCERTAIN:
+                ctx.n_fallback += 1
+            elif cell == _CELL_OUTSIDE:
+                ctx.n_not_applicable += 1
+            else:
+                ctx.n_colliding += 1
+                if cell == _CELL_CASE_III:
+                    return _CASE_III
+                elif cell == _CELL_CASE_II:
+                    return _CASE_II
+    if _arm_hits_body_c(ctx, A, sA, B, sB):
+        return _CASE_III
+    elif _arm_hits_body_c(ctx, B, sB, A, sA):
+        return _CASE_III
+    _place_arm_c(ctx, A, A.theta[sA], pA)
+    _place_arm_c(ctx, B, B.theta[sB], pB)
+    if _collide_c(ctx.kernel, A.placed_arm_x, A.placed_arm_y, A.n_arm, B.placed_arm_x, B.placed_arm_y, B.n_arm):
+        return _CASE_II
+    return _CASE_I
+
+cdef int _spatial_fixed_c(_CheckContext* ctx, _SweepGeom* A, Py_ssize_t sA) noexcept nogil:
+    """Same as PosCollider.spatial_collision_with_fixed(), at step sA of sweep A."""
+    cdef int k, cell
+    if ctx.n_fixed == 0:
+        return _CASE_I
+    if ctx.fixed_grid != NULL:
+        if ctx.fixed_loc < 0:
+            ctx.n_not_applicable += 1
+        else:
+            cell = _fixed_cell(ctx.fixed_grid, ctx.fixed_loc, A.theta[sA], A.phi[sA])
+            if cell == _CELL_CLEAR:
+                ctx.n_clear += 1
+                return _CASE_I
+            elif cell == _CELL_UNCERTAIN:
+                ctx.n_fallback += 1
+            elif cell == _CELL_OUTSIDE:
+                ctx.n_not_applicable += 1
+            else:
+                ctx.n_colliding += 1
+                return cell
+    _place_arm_c(ctx, A, A.theta[sA], A.phi[sA])
+    for k in range(ctx.n_fixed):
+        if _collide_c(ctx.kernel, A.placed_arm_x, A.placed_arm_y, A.n_arm, ctx.fixed_x[k], ctx.fixed_y[k], ctx.fixed_n[k]):
+            return ctx.fixed_case[k]
+    return _CASE_I
+
+cdef inline bint _was_moving_c(_SweepGeom* g, Py_ssize_t step) noexcept nogil:
+    """Same as PosSweep.was_moving()."""
+    if step <= 0 or step >= g.n:
+        return False
+    return g.moving[step]
+
+cdef int _sweeps_collide_c(_CheckContext* ctx, _SweepGeom* A, _SweepGeom* B, Py_ssize_t skip, Py_ssize_t* step) noexcept nogil:
+    """Steps through quantized sweep A, and either sweep B (pos-pos) or the fixed
+    keepouts (B == NULL), in the same way as PosCollider._spacetime_collision_reference().
+    Returns the first collision case found (_CASE_I if none), with the step of each
+    sweep at that time left in step[0] and step[1].
+    """
+    cdef Py_ssize_t remaining_A = A.n
+    cdef Py_ssize_t remaining_B = B.n if B != NULL else 0
+    cdef bint check
+    cdef int collision_case
+    step[0] = 0
+    step[1] = 0
+    while remaining_A or remaining_B:
+        check = _was_moving_c(A, step[0]) and step[0] >= skip
+        if B != NULL and _was_moving_c(B, step[1]) and step[1] >= skip:
+            check = True
+        if check:
+            if B != NULL:
+                collision_case = _spatial_pair_c(ctx, A, step[0], B, step[1])
+            else:
+                collision_case = _spatial_fixed_c(ctx, A, step[0])
+            if collision_case != _CASE_I:
+                return collision_case
+        remaining_A = remaining_A - 1 if remaining_A > 0 else 0
+        remaining_B = remaining_B - 1 if remaining_B > 0 else 0
+        if remaining_A:
+            step[0] += 1
+        if remaining_B:
+            step[1] += 1
+    return _CASE_I
+
 cpdef test():
     polys = []
     polys += [PosPoly([[0,1,1],[0,0,1]])]
@@ -1149,3 +2616,465 @@ cpdef test3():
                   [0.000, 1.014, 1.583,  1.037, -1.037, -1.583, -1.014]]
     p = PosPoly(keepout_phi)
     return p
+
+
+# Collision lookup table
+# ----------------------
+# A PosPairLookup is a 5-dimensional grid of cells, covering the spatial relationship
+# of two neighboring positioners A and B, in the frame where B lies along the +x axis
+# from A. The axes are:
+#
+#     d  ... center-to-center distance between the positioners (mm)
+#     t1 ... poslocT of A, minus the bearing angle of B from A (deg)
+#     p1 ... poslocP of A (deg)
+#     t2 ... poslocT of B, minus the bearing angle of B from A (deg)
+#     p2 ... poslocP of B (deg)
+#
+# Each cell holds one of 4 values (2 bits), stating what
+# PosCollider.spatial_collision_between_positioners() would find anywhere within that
+# cell (in its general case II / III branch):
+cdef enum:
+    _CELL_UNCERTAIN = 0 # must fall back to the exact polygon checks
+    _CELL_CLEAR = 1     # no collision anywhere in the cell
+    _CELL_CASE_II = 2   # case II collision everywhere in the cell
+    _CELL_CASE_III = 3  # case III collision everywhere in the cell
+    _CELL_GFA = 4       # (pos-fixed tables) GFA collision everywhere in the cell, same value as pc.case.GFA
+    _CELL_PTL = 5       # (pos-fixed tables) PTL collision everywhere in the cell, same value as pc.case.PTL
+    _CELL_OUTSIDE = 255 # (not stored) query was outside the grid
+#
+# Cells are classified using the nominal keepouts, at the cell center, with margins
+# covering the maximum motion of any keepout point within the cell, plus a geometry
+# slack which covers the per-positioner keepout deviations. So "clear" and "collision"
+# results are guaranteed, not sampled.
+#
+# The cell grid is only reached for phi angles below Ei_phi (see
+# spatial_collision_between_positioners), so the phi axes need not extend much beyond it.
+#
+# Swapping the roles of A and B gives the same physical arrangement, turned by 180 deg.
+# So with each positioner's state numbered as
+#     a = i_t1 * n_p + i_p1                         (A, as seen from A)
+#     b = ((i_t2 + n_t / 2) % n_t) * n_p + i_p2     (B, as seen from B)
+# cell (a, b) is the same as cell (b, a), and only the cells with a <= b are stored. For
+# each distance, cell (a, b) is at index b * (b + 1) / 2 + a among n_s * (n_s + 1) / 2 cells,
+# where n_s = n_t * n_p. This needs the theta step to evenly divide 180 deg.
+#
+# Binary file format (see save_pair_lookup):
+#     4 bytes  ... magic b'PCLT'
+#     4 bytes  ... little-endian uint32 length N of header
+#     N bytes  ... JSON header (kind 'pos-pos' or 'pos-fixed', grid definition, keepout_hash, version)
+#     padding  ... zero bytes up to a multiple of 8
+#     cells    ... pos-pos: 4 cells per byte, starting from the low bits, ordered by distance,
+#                  then index within the distance as above. pos-fixed: 1 byte per cell.
+pair_lookup_magic = b'PCLT'
+pair_lookup_version = 2
+_pair_lookup_grid_keys = ('d_min', 'd_step', 'n_d', 't_step', 'p_min', 'p_step', 'n_p')
+
+def pair_lookup_header(keepout_P, keepout_T, r1, d_min=10.0, d_step=0.1, n_d=8,
+                       t_step=10.0, p_min=-30.0, p_step=10.0, n_p=18, geometry_slack=0.5):
+    """Returns a header dict defining a PosPairLookup grid. The theta axes always
+    span 360 deg. The keepouts and r1 are the nominal ones, as in the collider's
+    general_keepout_P, general_keepout_T, and pc.nominals['LENGTH_R1'].
+    """
+    n_t = int(round(360.0 / t_step))
+    assert abs(n_t * t_step - 360.0) < 1e-9 and n_t % 2 == 0, f't_step {t_step} must evenly divide 180 deg'
+    return {'version': pair_lookup_version,
+            'kind': 'pos-pos',
+            'd_min': float(d_min), 'd_step': float(d_step), 'n_d': int(n_d),
+            't_step': float(t_step), 'n_t': n_t,
+            'p_min': float(p_min), 'p_step': float(p_step), 'n_p': int(n_p),
+            'geometry_slack': float(geometry_slack),
+            'keepout_hash': keepouts_hash(keepout_P, keepout_T, r1),
+            'keepout_P': keepout_P.points,
+            'keepout_T': keepout_T.points,
+            'r1': float(r1),
+            }
+
+def pair_lookup_size(header):
+    """Total number of stored cells in a PosPairLookup grid (see notes above)."""
+    n_s = header['n_t'] * header['n_p']
+    return header['n_d'] * (n_s * (n_s + 1) // 2)
+
+def keepouts_hash(PosPoly keepout_P, PosPoly keepout_T, r1):
+    """Hash string identifying the nominal geometry a lookup table was made for."""
+    return _polys_hash([keepout_P, keepout_T], r1)
+
+def _polys_hash(polys, r1):
+    data = [[round(v, 9) for v in axis] for poly in polys for axis in poly.points] + [round(float(r1), 9)]
+    return hashlib.sha1(json.dumps(data).encode()).hexdigest()
+
+def lookup_file_prefix(header):
+    """Bytes preceding the cells in a lookup table file: magic, header length, JSON
+    header, and padding. Writing this followed by the cells (possibly in chunks, as
+    done by collision_table_generator.py) produces a valid file.
+    """
+    header_bytes = json.dumps(header).encode()
+    prefix = pair_lookup_magic + len(header_bytes).to_bytes(4, 'little') + header_bytes
+    return prefix + bytes(-len(prefix) % 8)
+
+def save_pair_lookup(path, header, cells):
+    """Writes a lookup table file. The cells argument is any bytes-like object, as
+    returned by classify_pair_cells or classify_fixed_cells.
+    """
+    size = lookup_table_bytes(header)
+    assert len(cells) == size, f'{len(cells)} bytes of cells does not match header grid size {size}'
+    with open(path, 'wb') as file:
+        file.write(lookup_file_prefix(header))
+        file.write(cells)
+
+def read_lookup_file(path):
+    """Reads the header of any lookup table file, and memory-maps its cells (rather
+    than reading them into memory). Returns (header, cells).
+    """
+    with open(path, 'rb') as file:
+        magic = file.read(4)
+        assert magic == pair_lookup_magic, f'{path} is not a collision lookup table file'
+        n = int.from_bytes(file.read(4), 'little')
+        header = json.loads(file.read(n).decode())
+    assert header['version'] == pair_lookup_version, f'{path} has unsupported lookup table version {header["version"]}'
+    offset = 8 + n
+    offset += -offset % 8
+    cells = np.memmap(path, dtype=np.uint8, mode='r', offset=offset, shape=(lookup_table_bytes(header),))
+    return header, cells
+
+def load_pair_lookup(path):
+    """Reads a pos-pos lookup table file into a PosPairLookup."""
+    header, cells = read_lookup_file(path)
+    assert header.get('kind', 'pos-pos') == 'pos-pos', f'{path} is a {header["kind"]} table, not pos-pos'
+    return PosPairLookup(header, cells)
+
+def load_fixed_lookup(path):
+    """Reads a pos-fixed lookup table file into a PosFixedLookup."""
+    header, cells = read_lookup_file(path)
+    assert header.get('kind') == 'pos-fixed', f'{path} is not a pos-fixed table'
+    return PosFixedLookup(header, cells)
+
+def lookup_table_size(header):
+    """Total number of stored cells in a lookup table of either kind."""
+    if header.get('kind', 'pos-pos') == 'pos-fixed':
+        return fixed_lookup_size(header)
+    return pair_lookup_size(header)
+
+def lookup_table_bytes(header):
+    """Number of bytes of cells in a lookup table of either kind."""
+    if header.get('kind', 'pos-pos') == 'pos-fixed':
+        return fixed_lookup_size(header)
+    return (pair_lookup_size(header) + 3) // 4
+
+cdef class PosPairLookup:
+    """Collision lookup table for pairs of positioners. See notes above, and
+    PosCollider.spatial_collision_between_positioners().
+
+        header ... dict as generated by pair_lookup_header()
+        cells  ... 1D uint8 array-like of packed cell values, with lookup_table_bytes(header) elements
+    """
+    cdef public object header
+    cdef public double geometry_slack
+    cdef object _cells_ref
+    cdef const unsigned char[:] _cells
+    cdef _PairGrid grid
+
+    def __init__(self, header, cells):
+        self.header = header
+        self.geometry_slack = header['geometry_slack']
+        self.grid.d_min, self.grid.d_step, self.grid.n_d = header['d_min'], header['d_step'], header['n_d']
+        self.grid.t_step, self.grid.n_t = header['t_step'], header['n_t']
+        self.grid.p_min, self.grid.p_step, self.grid.n_p = header['p_min'], header['p_step'], header['n_p']
+        self.grid.n_s = <long long>self.grid.n_t * self.grid.n_p
+        self._cells_ref = cells
+        self._cells = cells
+        assert self._cells.shape[0] == lookup_table_bytes(header)
+        self.grid.cells = &self._cells[0]
+
+    cpdef int lookup(self, double d, double t1, double p1, double t2, double p2):
+        """Returns the cell value for the argued coordinates (see notes above), or
+        _CELL_OUTSIDE if they are outside the grid.
+        """
+        return _pair_cell(&self.grid, d, t1, p1, t2, p2)
+
+    def counts(self):
+        """Returns dict with number of stored cells of each type."""
+        packed = np.asarray(self._cells_ref)
+        values = np.zeros(4, dtype=np.int64)
+        chunk = 1 << 24 # bytes unpacked at a time, so large tables need not be unpacked all at once
+        for start in range(0, len(packed), chunk):
+            block = packed[start:start + chunk]
+            for shift in (0, 2, 4, 6):
+                values += np.bincount((block >> shift) & 3, minlength=4)
+        values[_CELL_UNCERTAIN] -= 4 * len(packed) - pair_lookup_size(self.header) # zero padding of the last byte
+        return {'uncertain': int(values[_CELL_UNCERTAIN]), 'clear': int(values[_CELL_CLEAR]),
+                'case II': int(values[_CELL_CASE_II]), 'case III': int(values[_CELL_CASE_III])}
+
+@cython.cdivision(True)
+cdef int _pair_cell(_PairGrid* grid, double d, double t1, double p1, double t2, double p2) noexcept nogil:
+    """Does the work for PosPairLookup.lookup()."""
+    cdef int i_d = <int>c_floor((d - grid.d_min) / grid.d_step)
+    cdef int i_p1 = <int>c_floor((p1 - grid.p_min) / grid.p_step)
+    cdef int i_p2 = <int>c_floor((p2 - grid.p_min) / grid.p_step)
+    cdef int i_t1, i_t2
+    cdef long long a, b, index
+    if i_d < 0 or i_d >= grid.n_d or i_p1 < 0 or i_p1 >= grid.n_p or i_p2 < 0 or i_p2 >= grid.n_p:
+        return _CELL_OUTSIDE
+    i_t1 = <int>c_floor(t1 / grid.t_step) % grid.n_t
+    i_t2 = <int>c_floor(t2 / grid.t_step) % grid.n_t
+    if i_t1 < 0:
+        i_t1 += grid.n_t
+    if i_t2 < 0:
+        i_t2 += grid.n_t
+    a = <long long>i_t1 * grid.n_p + i_p1 # state numbers and cell index, see notes above
+    b = <long long>((i_t2 + grid.n_t // 2) % grid.n_t) * grid.n_p + i_p2
+    if a > b:
+        a, b = b, a
+    index = i_d * (grid.n_s * (grid.n_s + 1) // 2) + b * (b + 1) // 2 + a
+    return (grid.cells[index >> 2] >> ((index & 3) * 2)) & 3
+
+def classify_pair_cells(header, start=0, stop=None):
+    """Classifies stored cells [start, stop) of the grid defined by header (see notes
+    above). Returns a bytearray of the packed cell values. Splitting the grid into
+    ranges allows the work to be distributed across processes (see
+    collision_table_generator.py). So that the bytes of consecutive ranges can simply
+    be concatenated, start must be a multiple of 4.
+    """
+    cdef PosPoly keepout_P = PosPoly(header['keepout_P'], close_polygon=False)
+    cdef PosPoly keepout_T = PosPoly(header['keepout_T'], close_polygon=False)
+    cdef double r1 = header['r1']
+    cdef int n_t = header['n_t']
+    cdef int n_p = header['n_p']
+    cdef double d_step = header['d_step']
+    cdef double t_step = header['t_step']
+    cdef double p_step = header['p_step']
+    cdef double rho_P = keepout_P.max_radius()
+    cdef double rho_T = keepout_T.max_radius()
+    cdef double motion_arm = (t_step / 2 * (r1 + rho_P) + p_step / 2 * rho_P) * rad_per_deg
+    cdef double motion_body = t_step / 2 * rho_T * rad_per_deg
+    cdef double slack = header['geometry_slack']
+    cdef double margin_arm_body = motion_arm + motion_body + d_step / 2 + slack
+    cdef double margin_arm_arm = 2 * motion_arm + d_step / 2 + slack
+    cdef long long n_s = <long long>n_t * n_p
+    cdef long long n_per_d = n_s * (n_s + 1) // 2
+    cdef long long i, j, a, b
+    cdef int i_d, i_t1, i_p1, i_t2, i_p2, value
+    cdef double d, t1, p1, t2, p2
+    cdef int A_on_B, B_on_A, arms
+    cdef PosPoly arm_A, body_A, arm_B, body_B
+    if stop is None:
+        stop = pair_lookup_size(header)
+    assert start % 4 == 0, f'start {start} of cells to classify must be a multiple of 4'
+    cells = bytearray((stop - start + 3) // 4)
+    for i in range(start, stop):
+        i_d = i // n_per_d
+        j = i % n_per_d
+        b = <long long>((c_sqrt(8.0 * j + 1.0) - 1.0) / 2.0)
+        while b * (b + 1) // 2 > j:
+            b -= 1
+        while (b + 1) * (b + 2) // 2 <= j:
+            b += 1
+        a = j - b * (b + 1) // 2
+        i_t1 = a // n_p
+        i_p1 = a % n_p
+        i_t2 = (b // n_p + n_t // 2) % n_t
+        i_p2 = b % n_p
+        d = header['d_min'] + (i_d + 0.5) * d_step
+        t1 = (i_t1 + 0.5) * t_step
+        p1 = header['p_min'] + (i_p1 + 0.5) * p_step
+        t2 = (i_t2 + 0.5) * t_step
+        p2 = header['p_min'] + (i_p2 + 0.5) * p_step
+        arm_A = keepout_P.place_as_phi_arm(t1, p1, 0.0, 0.0, r1)
+        body_A = keepout_T.place_as_central_body(t1, 0.0, 0.0)
+        arm_B = keepout_P.place_as_phi_arm(t2, p2, d, 0.0, r1)
+        body_B = keepout_T.place_as_central_body(t2, d, 0.0)
+        A_on_B = _robust_relation(arm_A, body_B, margin_arm_body)
+        B_on_A = _robust_relation(arm_B, body_A, margin_arm_body)
+        if A_on_B == _CELL_CASE_II or B_on_A == _CELL_CASE_II: # i.e. arm upon body collision, which is case III
+            value = _CELL_CASE_III
+        elif A_on_B == _CELL_CLEAR and B_on_A == _CELL_CLEAR:
+            arms = _robust_relation(arm_A, arm_B, margin_arm_arm)
+            value = arms # _CELL_CASE_II if colliding
+        else:
+            value = _CELL_UNCERTAIN
+        cells[(i - start) >> 2] |= value << (((i - start) & 3) * 2)
+    return cells
+
+cdef int _robust_relation(PosPoly X, PosPoly Y, double margin):
+    """Classifies relation of two polygons, when any of their points may move by up to
+    margin in total. Returns _CELL_CLEAR if they cannot collide (as defined by
+    collides_with), _CELL_CASE_II if they must collide, else _CELL_UNCERTAIN.
+    """
+    if X.distance_to(Y) > margin:
+        return _CELL_CLEAR
+    if _robustly_crosses(X, Y, margin) or _robustly_crosses(Y, X, margin):
+        return _CELL_CASE_II
+    return _CELL_UNCERTAIN
+
+cdef unsigned int _robustly_crosses(PosPoly X, PosPoly Y, double margin):
+    """True if X has one vertex inside Y and another outside Y, both further than
+    margin from Y's edges. Then X's boundary must cross Y's, for any motion within
+    the margin.
+    """
+    cdef unsigned int i, j
+    cdef unsigned int has_inside = False
+    cdef unsigned int has_outside = False
+    cdef double dist
+    for i in range(X.n_pts):
+        dist = INFINITY
+        for j in range(Y.n_pts - 1):
+            dist = c_fmin(dist, _point_segment_distance(X.x[i], X.y[i], Y.x[j], Y.y[j], Y.x[j+1], Y.y[j+1]))
+        if dist > margin:
+            if _point_in_polygon(X.x[i], X.y[i], Y.x, Y.y, Y.n_pts):
+                has_inside = True
+            else:
+                has_outside = True
+            if has_inside and has_outside:
+                return True
+    return False
+
+# Pos-fixed collision lookup table
+# --------------------------------
+# The same idea, for collisions of a phi arm with the fixed PTL and GFA keepouts (see
+# spatial_collision_with_fixed). The grid axes are:
+#     loc ... index into the header's list of device locations, with their nominal
+#             (x, y) centers. Only locations whose phi arm can reach a fixed keepout
+#             are listed.
+#     t   ... poslocT (deg)
+#     p   ... poslocP (deg)
+#
+# Cells hold _CELL_CLEAR, _CELL_GFA, _CELL_PTL, or _CELL_UNCERTAIN (including when a
+# cell definitely collides with both fixed keepouts, since the exact check reports
+# whichever it finds first). The geometry slack must cover both the deviation of a
+# positioner's center from nominal and of its phi keepout from the general one. Cells
+# are 1 byte each, and the file format is the same as for pos-pos tables.
+def fixed_lookup_header(keepout_P, keepout_PTL, keepout_GFA, r1, locations,
+                        t_step=1.0, p_min=-30.0, p_step=1.0, n_p=240, geometry_slack=0.5):
+    """Returns a header dict defining a PosFixedLookup grid. The argued locations are
+    a dict with key: device location id, value: nominal (x, y) center. The theta axis
+    always spans 360 deg.
+    """
+    cdef PosPoly P = keepout_P
+    n_t = int(round(360.0 / t_step))
+    assert abs(n_t * t_step - 360.0) < 1e-9, f't_step {t_step} must evenly divide 360 deg'
+    reach = r1 + P.max_radius() + geometry_slack
+    reachable = []
+    for loc in sorted(locations):
+        x, y = locations[loc]
+        circle = PosPoly(PosCollider._circle_poly_points(2 * reach, 64)).translated(x, y)
+        if circle.overlaps(keepout_PTL) or circle.overlaps(keepout_GFA):
+            reachable.append([int(loc), float(x), float(y)])
+    return {'version': pair_lookup_version,
+            'kind': 'pos-fixed',
+            'locations': reachable,
+            't_step': float(t_step), 'n_t': n_t,
+            'p_min': float(p_min), 'p_step': float(p_step), 'n_p': int(n_p),
+            'geometry_slack': float(geometry_slack),
+            'keepout_hash': fixed_keepouts_hash(keepout_P, keepout_PTL, keepout_GFA, r1),
+            'keepout_P': keepout_P.points,
+            'keepout_PTL': keepout_PTL.points,
+            'keepout_GFA': keepout_GFA.points,
+            'r1': float(r1),
+            }
+
+def fixed_lookup_size(header):
+    """Total number of cells in a PosFixedLookup grid."""
+    return len(header['locations']) * header['n_t'] * header['n_p']
+
+def fixed_keepouts_hash(PosPoly keepout_P, PosPoly keepout_PTL, PosPoly keepout_GFA, r1):
+    """Hash string identifying the nominal geometry a pos-fixed lookup table was made for."""
+    return _polys_hash([keepout_P, keepout_PTL, keepout_GFA], r1)
+
+cdef class PosFixedLookup:
+    """Collision lookup table for positioners against the fixed keepouts. See notes
+    above.
+
+        header ... dict as generated by fixed_lookup_header()
+        cells  ... 1D uint8 array-like of cell values, with fixed_lookup_size(header) elements
+    """
+    cdef public object header
+    cdef public double geometry_slack
+    cdef public dict loc_index # key: device location id, value: index on the loc axis
+    cdef object _cells_ref
+    cdef const unsigned char[:] _cells
+    cdef _FixedGrid grid
+
+    def __init__(self, header, cells):
+        self.header = header
+        self.geometry_slack = header['geometry_slack']
+        self.loc_index = {loc: i for i, (loc, x, y) in enumerate(header['locations'])}
+        self.grid.t_step, self.grid.n_t = header['t_step'], header['n_t']
+        self.grid.p_min, self.grid.p_step, self.grid.n_p = header['p_min'], header['p_step'], header['n_p']
+        self._cells_ref = cells
+        self._cells = cells
+        assert self._cells.shape[0] == fixed_lookup_size(header)
+        self.grid.cells = &self._cells[0]
+
+    def nominal_center(self, loc):
+        """Returns nominal (x, y) of a device location, or None if it is not in the table."""
+        if loc not in self.loc_index:
+            return None
+        return tuple(self.header['locations'][self.loc_index[loc]][1:])
+
+    def lookup(self, loc, double t, double p):
+        """Returns the cell value for the argued device location and poslocTP, or
+        _CELL_OUTSIDE if they are outside the grid.
+        """
+        cdef int i_loc = self.loc_index.get(loc, -1)
+        if i_loc < 0:
+            return _CELL_OUTSIDE
+        return _fixed_cell(&self.grid, i_loc, t, p)
+
+    def counts(self):
+        """Returns dict with number of cells of each type."""
+        values = np.bincount(np.asarray(self._cells_ref), minlength=6)
+        return {'uncertain': int(values[_CELL_UNCERTAIN]), 'clear': int(values[_CELL_CLEAR]),
+                'GFA': int(values[_CELL_GFA]), 'PTL': int(values[_CELL_PTL])}
+
+@cython.cdivision(True)
+cdef int _fixed_cell(_FixedGrid* grid, int i_loc, double t, double p) noexcept nogil:
+    """Does the work for PosFixedLookup.lookup(), given the index on the loc axis."""
+    cdef int i_p = <int>c_floor((p - grid.p_min) / grid.p_step)
+    cdef int i_t
+    if i_p < 0 or i_p >= grid.n_p:
+        return _CELL_OUTSIDE
+    i_t = <int>c_floor(t / grid.t_step) % grid.n_t
+    if i_t < 0:
+        i_t += grid.n_t
+    return grid.cells[(i_loc * grid.n_t + i_t) * grid.n_p + i_p]
+
+def classify_fixed_cells(header, start=0, stop=None):
+    """Classifies cells [start, stop) of the pos-fixed grid defined by header (see
+    notes above). Returns a bytearray of cell values.
+    """
+    cdef PosPoly keepout_P = PosPoly(header['keepout_P'], close_polygon=False)
+    cdef PosPoly keepout_PTL = PosPoly(header['keepout_PTL'], close_polygon=False)
+    cdef PosPoly keepout_GFA = PosPoly(header['keepout_GFA'], close_polygon=False)
+    cdef double r1 = header['r1']
+    cdef int n_t = header['n_t']
+    cdef int n_p = header['n_p']
+    cdef double t_step = header['t_step']
+    cdef double p_step = header['p_step']
+    cdef double rho_P = keepout_P.max_radius()
+    cdef double margin = (t_step / 2 * (r1 + rho_P) + p_step / 2 * rho_P) * rad_per_deg + header['geometry_slack']
+    cdef long i, j
+    cdef int i_loc, i_t, i_p, gfa, ptl
+    cdef double t, p
+    cdef PosPoly arm
+    locations = header['locations']
+    if stop is None:
+        stop = fixed_lookup_size(header)
+    cells = bytearray(stop - start)
+    for i in range(start, stop):
+        j = i
+        i_p = j % n_p; j //= n_p
+        i_t = j % n_t; j //= n_t
+        i_loc = j
+        t = (i_t + 0.5) * t_step
+        p = header['p_min'] + (i_p + 0.5) * p_step
+        arm = keepout_P.place_as_phi_arm(t, p, locations[i_loc][1], locations[i_loc][2], r1)
+        gfa = _robust_relation(arm, keepout_GFA, margin)
+        ptl = _robust_relation(arm, keepout_PTL, margin)
+        if gfa == _CELL_CLEAR and ptl == _CELL_CLEAR:
+            cells[i - start] = _CELL_CLEAR
+        elif gfa == _CELL_CASE_II and ptl == _CELL_CLEAR:
+            cells[i - start] = _CELL_GFA
+        elif ptl == _CELL_CASE_II and gfa == _CELL_CLEAR:
+            cells[i - start] = _CELL_PTL
+        else:
+            cells[i - start] = _CELL_UNCERTAIN
+    return cells
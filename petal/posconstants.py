@@ -73,33 +73,177 @@ fp_calibs_path_cache = os.path.join(dirs['temp_files'], 'latest_fp_calibs.txt')
 R_lookup_path = petal_directory + os.path.sep + 'focal_surface_lookup.csv'
 R_lookup_data = np.genfromtxt(R_lookup_path, comments="#", delimiter=",")
 
+class FocalSurfaceLookup(object):
+    """Piecewise-linear lookup of values fp at increasing knots xp, returning the
+    same values as np.interp(x, xp, fp, left=nan).
+
+    Rather than a binary search per point, the interval is found by direct index
+    into a uniform grid of bins, built once at init. Bins are half the smallest
+    knot spacing wide, so each holds at most one knot, and a single comparison
+    against it completes the search. Python floats are evaluated without going
+    through numpy at all, which matters for the per-positioner transforms.
+    """
+    def __init__(self, xp, fp):
+        xp, fp = np.array(xp, dtype=float), np.array(fp, dtype=float)
+        assert np.all(np.diff(xp) > 0), 'lookup knots must be strictly increasing'
+        self.x_first, self.x_last, self.f_last = float(xp[0]), float(xp[-1]), float(fp[-1])
+        self.bins_per_unit = 2.0 / np.diff(xp).min()
+        knot_bins = self._bin(xp)  # same arithmetic as for lookups, hence same rounding
+        n_bins = knot_bins[-1] + 1
+        self.bin_start = np.searchsorted(knot_bins, np.arange(n_bins), side='left') - 1  # last knot in an earlier bin
+        self.bin_start = np.maximum(self.bin_start, 0)
+        self.xp, self.fp = xp, fp
+        self.slopes = np.append(np.diff(fp) / np.diff(xp), 0.0)  # zero slope pads the last knot
+        self.bin_next = xp[self.bin_start + 1]
+        self._xp, self._fp, self._slopes, self._bin_start = [a.tolist() for a in [xp, fp, self.slopes, self.bin_start]]
+
+    def _bin(self, x):
+        return ((x - self.x_first) * self.bins_per_unit).astype(int)
+
+    def __call__(self, x):
+        if isinstance(x, float):
+            return self._scalar(x)
+        x = np.asarray(x, dtype=float)
+        clipped, j = self._interval(x)
+        y = self.slopes[j] * (clipped - self.xp[j]) + self.fp[j]
+        y = np.where(x >= self.x_first, y, np.nan)
+        return y if y.ndim else y[()]
+
+    def with_slope(self, x):
+        """Returns (lookup, derivative of lookup) at array x. The derivative is
+        the slope of the table interval containing each point (zero past the last
+        knot).
+        """
+        if isinstance(x, float):
+            return self._scalar(x), self._scalar_slope(x)
+        x = np.asarray(x, dtype=float)
+        clipped, j = self._interval(x)
+        slope = self.slopes[j]
+        y = slope * (clipped - self.xp[j]) + self.fp[j]
+        off_table = x < self.x_first
+        if off_table.any():
+            y, slope = np.where(off_table, np.nan, y), np.where(off_table, np.nan, slope)
+        return y, slope
+
+    def _interval(self, x):
+        """Returns x clipped to the table, and the index of its interval."""
+        clipped = np.fmin(np.fmax(x, self.x_first), self.x_last)  # also sends nan to x_first
+        k = self._bin(clipped)
+        return clipped, self.bin_start[k] + (clipped >= self.bin_next[k])
+
+    def _scalar(self, x):
+        if x < self.x_first:
+            return np.nan
+        if x >= self.x_last:
+            return self.f_last
+        if x != x:
+            return np.nan
+        j = self._bin_start[int((x - self.x_first) * self.bins_per_unit)]
+        if x >= self._xp[j + 1]:
+            j += 1
+        return self._slopes[j] * (x - self._xp[j]) + self._fp[j]
+
+    def _scalar_slope(self, x):
+        if x < self.x_first or x != x:
+            return np.nan
+        if x >= self.x_last:
+            return 0.0
+        j = self._bin_start[int((x - self.x_first) * self.bins_per_unit)]
+        return self._slopes[j + 1] if x >= self._xp[j + 1] else self._slopes[j]
+
 # Mapping of radial coordinate R to pseudo-radial coordinate S
 # (distance along focal surface from optical axis)
+_R2S = FocalSurfaceLookup(R_lookup_data[:,0], R_lookup_data[:,2])
+_S2R = FocalSurfaceLookup(R_lookup_data[:,2], R_lookup_data[:,0])
+_R2Z = FocalSurfaceLookup(R_lookup_data[:,0], R_lookup_data[:,1])
+_R2N = FocalSurfaceLookup(R_lookup_data[:,0], R_lookup_data[:,3])
+_N2R = FocalSurfaceLookup(R_lookup_data[:,3], R_lookup_data[:,0])
+_negZ2R = FocalSurfaceLookup(-R_lookup_data[:,1], R_lookup_data[:,0])  # Z decreases along the table, so lookups from Z are knotted on -Z
 def R2S_lookup(R):
-    return np.interp(R,R_lookup_data[:,0],R_lookup_data[:,2],left=float('nan'))
+    return _R2S(R)
 def S2R_lookup(S):
-    return np.interp(S,R_lookup_data[:,2],R_lookup_data[:,0],left=float('nan'))
+    return _S2R(S)
 def R2Z_lookup(R):
-    return np.interp(R,R_lookup_data[:,0],R_lookup_data[:,1],left=float('nan'))
-def Z2R_lookup(S):
-    return np.interp(S,R_lookup_data[:,1],R_lookup_data[:,0],left=float('nan'))
+    return _R2Z(R)
+def Z2R_lookup(Z):
+    return _negZ2R(np.negative(Z))
 def R2N_lookup(R):
-    return np.interp(R,R_lookup_data[:,0],R_lookup_data[:,3],left=float('nan'))
+    return _R2N(R)
 def N2R_lookup(S):
-    return np.interp(S,R_lookup_data[:,3],R_lookup_data[:,0],left=float('nan'))
+    return _N2R(S)
 
 # composite focal surface lookup methods for 3D out-of-shell QST transforms
+# All table columns are knotted at the same rows, so a composite like R2N(S2R(S))
+# is itself piecewise-linear between rows, and is looked up in a single step.
+_S2N = FocalSurfaceLookup(R_lookup_data[:,2], R_lookup_data[:,3])
+_S2Z = FocalSurfaceLookup(R_lookup_data[:,2], R_lookup_data[:,1])
+_N2S = FocalSurfaceLookup(R_lookup_data[:,3], R_lookup_data[:,2])
+_negZ2S = FocalSurfaceLookup(-R_lookup_data[:,1], R_lookup_data[:,2])
 def S2N_lookup(S):
-    return R2N_lookup(S2R_lookup(S))  # return nutation angles in degrees
+    return _S2N(S)  # return nutation angles in degrees
+
+def S2N_lookup_with_slope(S):
+    return _S2N.with_slope(S)  # nutation angles in degrees, and d(nutation)/dS in deg/mm
 
 def S2Z_lookup(S):
-    return R2Z_lookup(S2R_lookup(S))
+    return _S2Z(S)
 
 def Z2S_lookup(Z):
-    return R2S_lookup(Z2R_lookup(Z))
+    return _negZ2S(np.negative(Z))
 
 def N2S_lookup(N):
-    return R2S_lookup(N2R_lookup(N))  # takes nutation angles in degrees
+    return _N2S(N)  # takes nutation angles in degrees
+
+def focal_surface_lookup_errors(n=1000001):
+    """Compares the focal surface lookup functions above to chained np.interp
+    evaluations of R_lookup_data, at n points spread evenly over (and a little
+    beyond) each input's range, plus every knot. Lookups from Z are referenced
+    to np.interp on -Z, since np.interp needs increasing knots.
+
+    Returns dict keyed by lookup name, with values dicts of 'max abs err',
+    'max rel err', 'exact frac' (fraction of points agreeing exactly), and
+    'scalar==array' (whether python float inputs give the same results as
+    arrays, checked on every n/10000th point).
+    """
+    d = R_lookup_data
+    R, Z, S, N = 0, 1, 2, 3
+    def interp(x, i, j):
+        if i == Z:
+            return np.interp(-x, -d[:,Z], d[:,j], left=float('nan'))
+        return np.interp(x, d[:,i], d[:,j], left=float('nan'))
+    cases = {'R2S': (R, R2S_lookup, lambda x: interp(x, R, S)),
+             'S2R': (S, S2R_lookup, lambda x: interp(x, S, R)),
+             'R2Z': (R, R2Z_lookup, lambda x: interp(x, R, Z)),
+             'Z2R': (Z, Z2R_lookup, lambda x: interp(x, Z, R)),
+             'R2N': (R, R2N_lookup, lambda x: interp(x, R, N)),
+             'N2R': (N, N2R_lookup, lambda x: interp(x, N, R)),
+             'S2N': (S, S2N_lookup, lambda x: interp(interp(x, S, R), R, N)),
+             'S2Z': (S, S2Z_lookup, lambda x: interp(interp(x, S, R), R, Z)),
+             'Z2S': (Z, Z2S_lookup, lambda x: interp(interp(x, Z, R), R, S)),
+             'N2S': (N, N2S_lookup, lambda x: interp(interp(x, N, R), R, S))}
+    errors = {}
+    for name, (col, func, reference) in cases.items():
+        lo, hi = d[0,col], d[-1,col]
+        margin = 0.01 * (hi - lo)
+        x = np.concatenate([np.linspace(lo - margin, hi + margin, n), d[:,col]])
+        new, old = func(x), reference(x)
+        assert np.array_equal(np.isnan(new), np.isnan(old)), f'{name} nan mismatch'
+        ok = ~np.isnan(old)
+        err = np.abs(new[ok] - old[ok])
+        rel = err / np.maximum(np.abs(old[ok]), np.finfo(float).tiny)
+        scalar = np.array([func(float(v)) for v in x[::max(1, len(x)//10000)]])
+        errors[name] = {'max abs err': float(err.max()),
+                        'max rel err': float(rel.max()),
+                        'exact frac': float(np.mean(err == 0)),
+                        'scalar==array': np.array_equal(scalar, new[::max(1, len(x)//10000)], equal_nan=True)}
+    return errors
+
+def focal_surface_lookup_report(n=1000001):
+    """Returns a string table of focal_surface_lookup_errors(n)."""
+    lines = [f'{"lookup":>6} {"max abs err":>12} {"max rel err":>12} {"exact frac":>10} {"scalar==array":>13}']
+    for name, e in focal_surface_lookup_errors(n).items():
+        lines.append(f'{name:>6} {e["max abs err"]:12.3e} {e["max rel err"]:12.3e} {e["exact frac"]:10.6f} {str(e["scalar==array"]):>13}')
+    return '\n'.join(lines)
 
 # Generic map of positioner device locs to their neighboring locs
 generic_pos_neighbor_locs_path = os.path.join(petal_directory, 'generic_pos_neighbor_locs.csv')
@@ -175,6 +319,7 @@ theta_hardstop_ambig_exit_margin = 5.0 # deg, additional margin to ensure gettin
 # not too many motors spinning simultaneously.
 anneal_density = {'filled': 0.5,
                   'ramped': 0.35,
+                  'packed': 0.5, # as for 'filled', whose resulting peak number of concurrently moving motors then caps 'packed'
                   }
 max_targets_for_no_anneal = 123 # If the number of targets for each power supply is below or equal to this number, and anticollision is None or 'freeze', there is no need for annealing
 
@@ -439,8 +584,10 @@ nonfreeze_adjustment_methods = ['pause',
                                 'repel_ccw_A', 'repel_cw_A',
                                 'repel_ccw_B', 'repel_cw_B']
 all_adjustment_methods = nonfreeze_adjustment_methods + ['freeze']
+combined_adjustment_methods = [rot + '+' + ext for rot in nonfreeze_adjustment_methods if 'rot' in rot  # rotation followed immediately by extension or retraction, e.g. 'rot_ccw_A+retract_B'
+                               for ext in nonfreeze_adjustment_methods if 'extend' in ext or 'retract' in ext]  # only tried with collider setting COMBINED_ADJUSTMENTS
 useless_with_unmoving_neighbor = {'pause'} | {m for m in nonfreeze_adjustment_methods if 'repel' in m}
-useless_with_fixed_boundary = useless_with_unmoving_neighbor | {m for m in nonfreeze_adjustment_methods if 'extend' in m}
+useless_with_fixed_boundary = useless_with_unmoving_neighbor | {m for m in nonfreeze_adjustment_methods + combined_adjustment_methods if 'extend' in m}
 num_timesteps_clearance_margin = 2  # this value * PosCollider.timestep --> small extra wait for a neighbor to move out of way
 
 # Initial polygon debouncing settings
@@ -279,58 +279,104 @@ class PosModel(object):
             None
         See the debounced_range() and near_full_range() methods of Axis class for their
         specific meanings.
+
+        See true_moves() for the equivalent calculation on a whole sequence of moves.
         """
         start = self.expected_current_posintTP if not init_posintTP else init_posintTP
-        if self.axis[axisid].is_locked:
-            new_distance = 0.0
-            if self.is_linphi and axisid == pc.P and distance != new_distance:
-                if self.DEBUG > 1:
-                    self.printfunc(f'{self.posid} linphi Distance = {distance} changed to {new_distance}')  # DEBUG
-            distance = new_distance
+        moves = self.true_moves(axisid, [distance], allow_cruise, limits=limits, start_pos=start[axisid])
+        return {key: values[0] for key, values in moves.items()}
+
+    def true_moves(self, axisid, distances, allow_cruise, limits='debounced', start_pos=None, chained=False):
+        """Batch version of true_move(), for a sequence of move distances on one axis.
+
+        Returns a dictionary with the same keys as true_move(), each holding a list
+        of values, one per element of distances. The quantization is identical to
+        calling true_move() on each element, but the axis constants (gear ratio,
+        limits, step sizes, speeds) are looked up only once per call.
+
+        The argument 'start_pos' is the shaft position (posintT or posintP) at which
+        the moves start. It may be a single value or a sequence of the same length as
+        distances. If None, the expected current position is used.
+
+        With chained=True, the moves are performed one after another, i.e. each one
+        starts where the previous (quantized) move ended. This is the case for the
+        rows of a move table, and matters only when truncating to limits.
+        """
+        axis = self.axis[axisid]
+        if start_pos is None:
+            start_pos = self.expected_current_posintTP[axisid]
+        scalar_start = chained or not hasattr(start_pos, '__len__')
+        if axis.is_locked:
+            limits = None
         elif limits:
             use_near_full_range = (limits == 'near_full')
-            new_distance = self.axis[axisid].truncate_to_limits(distance, start[axisid], use_near_full_range)
-            if self.is_linphi and axisid == pc.P and distance != new_distance:
-                if self.DEBUG > 1:
-                    self.printfunc(f'{self.posid} linphi Distance = {distance} changed to {new_distance}')  # DEBUG
-            distance = new_distance
-        motor_dist = self.axis[axisid].shaft_to_motor(distance)
-        move_data = self.motor_true_move(axisid, motor_dist, allow_cruise)
-        move_data['distance'] = self.axis[axisid].motor_to_shaft(move_data['distance'])
-        move_data['speed']    = self.axis[axisid].motor_to_shaft(move_data['speed'])
-        return move_data
+            maxpos = axis.get_maxpos(use_near_full_range)
+            minpos = axis.get_minpos(use_near_full_range)
+        debug_linphi = self.DEBUG > 1 and self.is_linphi and axisid == pc.P
+        gear_ratio = axis.signed_gear_ratio
+        quantize = self._motor_quantizer(axisid, allow_cruise)
+        moves = {'motor_step': [], 'distance': [], 'speed_mode': [], 'speed': [], 'move_time': []}
+        for i, distance in enumerate(distances):
+            start = start_pos if scalar_start else start_pos[i]
+            if axis.is_locked:
+                new_distance = 0.0
+            elif limits and distance != 0:  # as Axis.truncate_to_limits(), with limits looked up above
+                new_distance = axis.truncate_between(distance, start, minpos, maxpos)
+            else:
+                new_distance = distance
+            if debug_linphi and distance != new_distance:
+                self.printfunc(f'{self.posid} linphi Distance = {distance} changed to {new_distance}')  # DEBUG
+            step, motor_dist, speed_mode, motor_speed, move_time = quantize(new_distance * gear_ratio)
+            moves['motor_step'].append(step)
+            moves['distance'].append(motor_dist / gear_ratio)
+            moves['speed_mode'].append(speed_mode)
+            moves['speed'].append(motor_speed / gear_ratio)
+            moves['move_time'].append(move_time)
+            if chained:
+                start_pos += moves['distance'][-1]
+        return moves
 
     def motor_true_move(self, axisid, distance, allow_cruise):
         """Calculation of cruise, creep, spinup, and spindown details for a move of
         an argued distance on the axis identified by axisid.
         """
-        move_data = {}
+        values = self._motor_quantizer(axisid, allow_cruise)(distance)
+        return dict(zip(['motor_step', 'distance', 'speed_mode', 'speed', 'move_time'], values))
+
+    def _motor_quantizer(self, axisid, allow_cruise):
+        """Returns a function which quantizes a motor distance into steps, for the
+        axis identified by axisid. The function returns a tuple of:
+            (motor_step, distance, speed_mode, speed, move_time)
+        The axis's step sizes, speeds, and spinup / spindown distance are bound in
+        once, so the function may be applied cheaply to many distances.
+        """
         allow_creep = False if self.is_linphi and axisid == pc.P else True
-        dist_spinup = 2 * pc.sign(distance) * self._spinupdown_distance(axisid)  # distance over which accel / decel to and from cruise speed
-        if allow_creep and ( not(allow_cruise) or abs(distance) <= (abs(dist_spinup) + self.state._val['MIN_DIST_AT_CRUISE_SPEED'])):
-            if self.is_linphi and axisid == pc.P and abs(distance) > 0.00001: # in mm, == 10 microns
-                ddist = self.axis[axisid].motor_to_shaft(distance)
-                self.printfunc(f'{self.posid} linphi Distance = {ddist}, MotDist = {distance}, WARNING: creep on linphi')  # DEBUG
-            move_data['motor_step']   = int(round(distance / self._stepsize_creep))
-            move_data['distance']     = move_data['motor_step'] * self._stepsize_creep
-            move_data['speed_mode']   = 'creep'
-            move_data['speed']        = self._motor_speed_creep
-            move_data['move_time']    = abs(move_data['distance']) / move_data['speed']
-        else:
+        spinupdown = self._spinupdown_distance(axisid)  # distance over which accel / decel to and from cruise speed
+        min_dist_at_cruise = self.state._val['MIN_DIST_AT_CRUISE_SPEED']
+        stepsize_creep = self._stepsize_creep
+        speed_creep = self._motor_speed_creep
+        stepsize_cruise = self._stepsize_cruise[axisid]
+        speed_cruise = self._motor_speed_cruise[axisid]
+        debug_linphi = self.DEBUG > 1 and not allow_creep
+
+        def quantize(distance):
+            dist_spinup = 2 * pc.sign(distance) * spinupdown
+            if allow_creep and (not(allow_cruise) or abs(distance) <= (abs(dist_spinup) + min_dist_at_cruise)):
+                step = int(round(distance / stepsize_creep))
+                quantized = step * stepsize_creep
+                return step, quantized, 'creep', speed_creep, abs(quantized) / speed_creep
             dist_cruise = distance - dist_spinup
-            move_data['motor_step']   = int(round(dist_cruise / self._stepsize_cruise[axisid]))
-            move_data['distance']     = move_data['motor_step'] * self._stepsize_cruise[axisid] + dist_spinup
-            move_data['speed_mode']   = 'cruise'
-            move_data['speed']        = self._motor_speed_cruise[axisid]
-            if move_data['motor_step'] == 0:
-                move_data['move_time'] = 0
+            step = int(round(dist_cruise / stepsize_cruise))
+            quantized = step * stepsize_cruise + dist_spinup
+            if step == 0:
+                move_time = 0
             else:
-                move_data['move_time'] = (abs(move_data['motor_step'])*self._stepsize_cruise[axisid] + 4*self._spinupdown_distance(axisid)) / move_data['speed']
-            if self.DEBUG > 1:
-                if self.is_linphi and axisid == pc.P and distance != 0.0:
-                    ddist = self.axis[axisid].motor_to_shaft(distance)
-                    self.printfunc(f'{self.posid} linphi Distance = {ddist}, MotDist = {distance}, Spinupdown = {dist_spinup}, dist_cruise = {dist_cruise}, steps = {move_data["motor_step"]}')  # DEBUG
-        return move_data
+                move_time = (abs(step)*stepsize_cruise + 4*spinupdown) / speed_cruise
+            if debug_linphi and distance != 0.0:
+                ddist = self.axis[axisid].motor_to_shaft(distance)
+                self.printfunc(f'{self.posid} linphi Distance = {ddist}, MotDist = {distance}, Spinupdown = {dist_spinup}, dist_cruise = {dist_cruise}, steps = {step}')  # DEBUG
+            return step, quantized, 'cruise', speed_cruise, move_time
+        return quantize
 
     def postmove_cleanup(self, cleanup_table):
         """Always perform this after positioner physical moves have been
@@ -544,6 +590,14 @@ class Axis(object):
         minpos = self.get_minpos(use_near_full_range)
         if start_pos == None:
             start_pos = self.pos
+        return self.truncate_between(distance, start_pos, minpos, maxpos)
+
+    @staticmethod
+    def truncate_between(distance, start_pos, minpos, maxpos):
+        """Return distance after truncating it (if necessary) such that the move
+        from start_pos ends within [minpos, maxpos]. This is the arithmetic of
+        truncate_to_limits(), for callers which have already looked up the limits.
+        """
         target_pos = start_pos + distance
         if maxpos < minpos:
             distance = 0
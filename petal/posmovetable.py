@@ -2,6 +2,9 @@ import posmodel
 import posconstants as pc
 import copy as copymodule
 
+_cached_output_types = {'collider', 'schedule', 'timing'} # table formats memoized by PosMoveTable._for_output_type
+_max_cached_fingerprints = 8 # per table, limit on number of distinct input states memoized at once
+
 class PosMoveTable(object):
     """A move table contains the information for a single positioner's move
     sequence, in both axes. This object defines the move table structure, and
@@ -42,6 +45,9 @@ class PosMoveTable(object):
         self._warning_flag = 'WARNING'
         self._error_flag = 'ERROR'
         self._not_yet_calculated = '(not yet calculated)'
+        self._rows_revision = 0          # incremented whenever rows are altered, invalidating the caches below
+        self._true_moves_cache = {}      # keys: inputs fingerprint, values: (true moves, extra rows) from _calculate_true_moves
+        self._format_cache = {}          # keys: (output_type, inputs fingerprint), values: (output table, extra rows)
 
     def _set_zeno_dict(self, d):
         if self.posmodel.is_linphi:
@@ -180,6 +186,8 @@ class PosMoveTable(object):
         new = copymodule.copy(self) # intentionally shallow, then will deep-copy just the row instances as needed below
         new.rows = [row.copy() for row in self.rows]
         new._rows_extra = [row.copy() for row in self._rows_extra]
+        new._true_moves_cache = self._true_moves_cache.copy() # cached values are never altered, so the copy may share them
+        new._format_cache = self._format_cache.copy()
         return new
 
     # getters
@@ -338,6 +346,7 @@ class PosMoveTable(object):
         if rowidx >= len(self.rows):
             self.insert_new_row(rowidx)
         self.rows[rowidx].data[dist_label[axisid]] = distance
+        self._rows_altered()
 
     def store_orig_command(self, string, val1=None, val2=None):
         '''To keep a note of original move command associated with this move
@@ -368,6 +377,7 @@ class PosMoveTable(object):
         if rowidx >= len(self.rows):
             self.insert_new_row(rowidx)
         self.rows[rowidx].data['prepause'] = prepause
+        self._rows_altered()
 
     def set_postpause(self, rowidx, postpause):
         """Put or update a postpause into the table.
@@ -377,6 +387,7 @@ class PosMoveTable(object):
         if rowidx >= len(self.rows):
             self.insert_new_row(rowidx)
         self.rows[rowidx].data['postpause'] = postpause
+        self._rows_altered()
 
     def set_required(self, boolean):
         '''Set flag which will be ultimately passed along to hardware. It tells
@@ -413,6 +424,7 @@ class PosMoveTable(object):
             has_postpause = self.rows[i].has_postpause
             if not has_motion and not has_prepause and not has_postpause:
                 del self.rows[i]
+        self._rows_altered()
 
     def compact(self):
         '''Removes two things from table:
@@ -433,16 +445,19 @@ class PosMoveTable(object):
                         prev_postpause += prepause + postpause
                         self.set_postpause(i-1, prev_postpause)
                     del self.rows[i]
+        self._rows_altered()
 
     # row manipulations
     def insert_new_row(self, index):
         newrow = PosMoveRow()
         self.rows.insert(index, newrow)
+        self._rows_altered()
         if index > len(self.rows):
             self.insert_new_row(index) # to fill in any blanks up to index
 
     def delete_row(self, index):
         del self.rows[index]
+        self._rows_altered()
 
     def extend(self, other_move_table):
         """Extend one move table with another.
@@ -454,6 +469,7 @@ class PosMoveTable(object):
             return
         for otherrow in other_move_table.rows:
             self.rows.append(otherrow.copy())
+        self._rows_altered()
         for axisid, cmd_str in other_move_table._postmove_cleanup_cmds.items():
             self.append_postmove_cleanup_cmd(axisid=axisid, cmd_str=cmd_str)
         self.append_log_note(other_move_table.log_note)
@@ -474,35 +490,78 @@ class PosMoveTable(object):
         self._is_required |= other_move_table._is_required
 
     # internal methods
+    def _rows_altered(self):
+        """Invalidates cached true moves and output formats. Must be called by
+        any method which alters the rows.
+        """
+        self._rows_revision += 1
+        self._true_moves_cache = {}
+        self._format_cache = {}
+
+    def _inputs_fingerprint(self):
+        """Returns a hashable value which changes whenever any input to the true
+        move calculations changes. Besides the rows, this includes the public
+        flags (which callers may set directly), the starting position, and the
+        posmodel's state (calibrations, locks, etc.) as tracked by its revision.
+        """
+        return (self._rows_revision,
+                self.posmodel.state.revision,
+                tuple(self.init_posintTP),
+                self.should_antibacklash,
+                self.should_final_creep,
+                self.allow_cruise,
+                self.allow_exceed_limits)
+
     def _calculate_true_moves(self):
         """Uses PosModel instance to get the real, quantized, calibrated values.
         Anti-backlash and final creep moves are added as necessary.
+
+        Results are cached, until the rows or any other inputs change (see
+        _inputs_fingerprint). The returned structure must not be modified.
+        """
+        fingerprint = self._inputs_fingerprint()
+        if fingerprint in self._true_moves_cache:
+            true_and_new, rows_extra = self._true_moves_cache[fingerprint]
+            self._rows_extra = [row.copy() for row in rows_extra]
+            return true_and_new
+        true_and_new = self._calculate_true_moves_uncached()
+        if len(self._true_moves_cache) >= _max_cached_fingerprints:
+            self._true_moves_cache = {}
+        self._true_moves_cache[fingerprint] = (true_and_new, [row.copy() for row in self._rows_extra])
+        return true_and_new
+
+    def _calculate_true_moves_uncached(self):
+        """Does the work for _calculate_true_moves().
+
+        Returns a list of [theta, phi] true moves, each in the batch format of
+        PosModel.true_moves(), i.e. a dict of lists with one element per row
+        (including the anti-backlash and final creep rows).
         """
         latest_TP = [x for x in self.init_posintTP]
         backlash = [0, 0]
-        true_moves = [[], []]
-        new_moves = [[], []]
-        true_and_new = [[], []]
+        true_and_new = [None, None]
         has_moved = [False, False]
         normal_row_limits = None if self.allow_exceed_limits else 'debounced'
         extra_row_limits = None if self.allow_exceed_limits else 'near_full'
         axis_idxs = [pc.T, pc.P]
-        for row in self.rows:
-            ideal_dist = [row.data['dT_ideal'], row.data['dP_ideal']]
-            for i in [pc.T,pc.P]:
-                if self.posmodel.is_linphi and i == pc.P:
-                    my_allow_cruise = True
-                else:
-                    my_allow_cruise = self.allow_cruise
-                move = self.posmodel.true_move(axisid=i,
-                                               distance=ideal_dist[i],
-                                               allow_cruise=my_allow_cruise,
-                                               limits=normal_row_limits,
-                                               init_posintTP=latest_TP)
-                true_moves[i].append(move)
-                latest_TP[i] += true_moves[i][-1]['distance']
-                if true_moves[i][-1]['distance']:
+        ideal_keys = {pc.T: 'dT_ideal', pc.P: 'dP_ideal'}
+        auto_cmds = []
+        for i in axis_idxs:
+            if self.posmodel.is_linphi and i == pc.P:
+                my_allow_cruise = True
+            else:
+                my_allow_cruise = self.allow_cruise
+            moves = self.posmodel.true_moves(axisid=i,
+                                             distances=[row.data[ideal_keys[i]] for row in self.rows],
+                                             allow_cruise=my_allow_cruise,
+                                             limits=normal_row_limits,
+                                             start_pos=latest_TP[i],
+                                             chained=True)
+            for distance in moves['distance']:
+                latest_TP[i] += distance
+                if distance:
                     has_moved[i] = True
+            true_and_new[i] = moves
         if self.should_antibacklash and any(has_moved):
             backlash_dir = [self.posmodel.state._val['ANTIBACKLASH_FINAL_MOVE_DIR_T'],
                             self.posmodel.state._val['ANTIBACKLASH_FINAL_MOVE_DIR_P']]
@@ -510,20 +569,12 @@ class PosMoveTable(object):
             for i in axis_idxs:
                 if self.posmodel.is_linphi and i == pc.P:
                     backlash[i] = 0.0
-                    auto_cmd_msg = ''
                     my_allow_cruise = False
                 else:
                     backlash[i] = -backlash_dir[i] * backlash_mag * has_moved[i]
-                    auto_cmd_msg = '(auto backlash backup)'
                     my_allow_cruise = self.allow_cruise
-                move = self.posmodel.true_move(axisid=i,
-                                               distance=backlash[i],
-                                               allow_cruise=my_allow_cruise,
-                                               limits=extra_row_limits,
-                                               init_posintTP=latest_TP)
-                new_moves[i].append(move)
-                new_moves[i][-1]['auto_cmd'] = auto_cmd_msg
-                latest_TP[i] += new_moves[i][-1]['distance']
+                latest_TP[i] += self._append_true_move(true_and_new[i], i, backlash[i], my_allow_cruise, extra_row_limits, latest_TP[i])
+            auto_cmds.append('(auto backlash backup)')
         if self.should_final_creep or any(backlash):
             ideal_total = [0, 0]
             ideal_total[pc.T] = sum([row.data['dT_ideal'] for row in self.rows])
@@ -545,32 +596,51 @@ class PosMoveTable(object):
                         err_dist[i] = pc.sign(err_dist[i]) * pc.max_auto_creep_distance
                     else:
                         auto_cmd_warning = ''
-                move = self.posmodel.true_move(axisid=i,
-                                               distance=err_dist[i],
-                                               allow_cruise=False,
-                                               limits=extra_row_limits,
-                                               init_posintTP=latest_TP)
-                new_moves[i].append(move)
-                new_moves[i][-1]['auto_cmd'] = f'(auto final creep{auto_cmd_warning})'
-                latest_TP[i] += new_moves[i][-1]['distance']
+                if i == pc.T:
+                    auto_cmds.append(f'(auto final creep{auto_cmd_warning})')
+                latest_TP[i] += self._append_true_move(true_and_new[i], i, err_dist[i], False, extra_row_limits, latest_TP[i])
         self._rows_extra = []
-        for i in range(len(new_moves[0])):
+        n_rows = len(self.rows)
+        for j, auto_cmd in enumerate(auto_cmds):
             self._rows_extra.append(PosMoveRow())
-            self._rows_extra[i].data = {'dT_ideal': new_moves[pc.T][i]['distance'],
-                                        'dP_ideal': new_moves[pc.P][i]['distance'],
+            self._rows_extra[j].data = {'dT_ideal': true_and_new[pc.T]['distance'][n_rows + j],
+                                        'dP_ideal': true_and_new[pc.P]['distance'][n_rows + j],
                                         'prepause': 0,
                                         'postpause': 0,
-                                        'auto_cmd': new_moves[pc.T][i]['auto_cmd'],
+                                        'auto_cmd': auto_cmd,
                                         }
-        for i in [pc.T,pc.P]:
-            true_and_new[i].extend(true_moves[i])
-            true_and_new[i].extend(new_moves[i])
         return true_and_new
 
+    def _append_true_move(self, moves, axisid, distance, allow_cruise, limits, start_pos):
+        """Appends one extra (auto-generated) true move to the batch moves for axisid.
+        Returns the quantized distance of that move.
+        """
+        new_move = self.posmodel.true_moves(axisid, [distance], allow_cruise, limits=limits, start_pos=start_pos)
+        for key, values in new_move.items():
+            moves[key].extend(values)
+        return new_move['distance'][0]
+
     def _for_output_type(self, output_type):
         """Internal function that calculates the various output table formats and
         passes them up to the wrapper functions above.
+
+        The formats most frequently requested during scheduling are cached (see
+        _calculate_true_moves). Callers always receive their own copy.
         """
+        if output_type not in _cached_output_types:
+            return self._for_output_type_uncached(output_type)
+        key = (output_type, self._inputs_fingerprint())
+        if key not in self._format_cache:
+            table = self._for_output_type_uncached(output_type)
+            if len(self._format_cache) >= _max_cached_fingerprints:
+                self._format_cache = {}
+            self._format_cache[key] = (table, [row.copy() for row in self._rows_extra])
+        table, rows_extra = self._format_cache[key]
+        self._rows_extra = [row.copy() for row in rows_extra]
+        return {k: v.copy() if isinstance(v, list) else v for k, v in table.items()}
+
+    def _for_output_type_uncached(self, output_type):
+        """Does the work for _for_output_type()."""
         true_moves = self._calculate_true_moves()
         rows = self.rows.copy()
         rows.extend(self._rows_extra)
@@ -578,26 +648,26 @@ class PosMoveTable(object):
         table = {}
         lock_note = ''
         if output_type in {'collider', 'schedule', 'full', 'cleanup', 'angles'}:
-            table['dT'] = [true_moves[pc.T][i]['distance'] for i in row_range]
-            table['dP'] = [true_moves[pc.P][i]['distance'] for i in row_range]
+            table['dT'] = list(true_moves[pc.T]['distance'])
+            table['dP'] = list(true_moves[pc.P]['distance'])
         if output_type in {'collider', 'schedule', 'full'}:
-            table['Tdot'] = [true_moves[pc.T][i]['speed'] for i in row_range]
-            table['Pdot'] = [true_moves[pc.P][i]['speed'] for i in row_range]
+            table['Tdot'] = list(true_moves[pc.T]['speed'])
+            table['Pdot'] = list(true_moves[pc.P]['speed'])
         if output_type in {'collider', 'schedule', 'full', 'timing'}:
             table['prepause'] = [rows[i].data['prepause'] for i in row_range]
             table['postpause'] = [rows[i].data['postpause'] for i in row_range]
         if output_type in {'hardware', 'full'}:
-            table['motor_steps_T'] = [true_moves[pc.T][i]['motor_step'] for i in row_range]
-            table['motor_steps_P'] = [true_moves[pc.P][i]['motor_step'] for i in row_range]
+            table['motor_steps_T'] = list(true_moves[pc.T]['motor_step'])
+            table['motor_steps_P'] = list(true_moves[pc.P]['motor_step'])
         if output_type in {'hardware', 'full', 'cleanup'}:
-            table['speed_mode_T'] = [true_moves[pc.T][i]['speed_mode'] for i in row_range]
-            table['speed_mode_P'] = [true_moves[pc.P][i]['speed_mode'] for i in row_range]
+            table['speed_mode_T'] = list(true_moves[pc.T]['speed_mode'])
+            table['speed_mode_P'] = list(true_moves[pc.P]['speed_mode'])
         if output_type in {'full', 'cleanup'}:
             table['orig_command'] = self._orig_command
             table['auto_commands'] = [rows[i].data['auto_cmd'] for i in row_range]
         if output_type in {'collider', 'schedule', 'full', 'hardware', 'timing'}:
-            table['move_time'] = [max(true_moves[pc.T][i]['move_time'],
-                                      true_moves[pc.P][i]['move_time']) for i in row_range]
+            table['move_time'] = [max(t, p) for t, p in zip(true_moves[pc.T]['move_time'],
+                                                                 true_moves[pc.P]['move_time'])]
         if output_type in {'full', 'cleanup', 'hardware'}:
             locked_axes = [name for num, name in {pc.T: 'T', pc.P: 'P'}.items() if self.posmodel.axis[num].is_locked]
             for axis in locked_axes:
@@ -698,7 +768,9 @@ class PosMoveRow(object):
         return repr(self.data)
 
     def copy(self):
-        return copymodule.deepcopy(self)
+        new = PosMoveRow()
+        new.data = self.data.copy() # values are all immutable, so shallow copy suffices
+        return new
 
     @property
     def has_motion(self):
@@ -0,0 +1,353 @@
+import posconstants as pc
+import math
+import time
+import heapq
+import bisect
+
+class PosReservation(object):
+    """Space-time reservation of a positioner, i.e. the planned path of its
+    (poslocT,poslocP) position as a function of time. The path is piecewise
+    linear between waypoints, just as in PosSweep. Before the first waypoint and
+    after the last one, the positioner is stationary there. PosPlanner counts
+    time in collider timesteps.
+
+        poslocTP   ... starting position
+        start_time ... time of the first waypoint
+    """
+    def __init__(self, poslocTP, start_time=0.0):
+        self.times = [start_time]
+        self.tps = [tuple(poslocTP)]
+
+    def append(self, time, poslocTP):
+        """Adds a waypoint, reached at time (which must be >= the last one)."""
+        self.times.append(time)
+        self.tps.append(tuple(poslocTP))
+
+    @property
+    def end_time(self):
+        return self.times[-1]
+
+    def tp_at(self, time):
+        """Returns the (poslocT,poslocP) position at time."""
+        i = bisect.bisect_right(self.times, time)
+        if i == 0:
+            return self.tps[0]
+        if i == len(self.times):
+            return self.tps[-1]
+        t0, t1 = self.times[i-1], self.times[i]
+        a, b = self.tps[i-1], self.tps[i]
+        if t1 == t0 or a == b:
+            return a
+        f = (time - t0) / (t1 - t0)
+        return (a[0] + f * (b[0] - a[0]), a[1] + f * (b[1] - a[1]))
+
+    def is_moving_during(self, t0, t1):
+        """Returns boolean whether the position changes at all within [t0,t1]."""
+        if t1 <= self.times[0] or t0 >= self.times[-1]:
+            return False
+        i = max(bisect.bisect_right(self.times, t0) - 1, 0)
+        j = min(bisect.bisect_left(self.times, t1), len(self.times) - 1)
+        return any(self.tps[k] != self.tps[i] for k in range(i + 1, j + 1))
+
+class PosPlanner(object):
+    """Prioritized space-time path planner for the anticollision='plan' mode of
+    PosSchedule, in the style of cooperative A*.
+
+    Positioners are planned one at a time, in priority order. Each one searches
+    for the earliest arrival at its target, over a lattice of (theta, phi, time).
+    Theta waypoints are evenly spaced along its requested rotation, no further
+    apart than PLANNER_THETA_STEP. Phi waypoints are its starting phi, its target
+    phi, and the retracted phi of the 'adjust' scheme (poslocP = PHI_EO). The
+    available moves are waiting (PLANNER_WAIT_STEP), a theta move to an adjacent
+    waypoint, a phi move to any other phi waypoint, and a direct (simultaneous
+    theta and phi) move to the target.
+
+    Once planned, a positioner's path is kept in a reservation table (one
+    PosReservation per posid). Later positioners check each candidate move only
+    against the reservations of their own neighbors, using the collider's spatial
+    checks at every collider timestep. Every pair of neighbors is thus checked
+    with both of their actual paths, by whichever is planned second. Unrequested
+    positioners are stationary. Not-yet-planned ones are assumed to retract phi
+    (as in the 'adjust' scheme) at their release times and then wait. That is only
+    a guess, to keep earlier positioners from steering around neighbors' starting
+    positions, where in reality they won't stay.
+
+    Time is counted in collider timesteps. Move times come from PosModel.true_move(),
+    and every move is started just past a timestep, so the planned positions match
+    what the collider will see after PosSweep.quantize(), step for step.
+
+    The search for a positioner is bounded by PLANNER_MAX_EXPANSIONS lattice
+    nodes, and by PLANNER_MAX_WAIT seconds of waiting beyond its direct move time.
+    Positioners which fail are retried once, after all the others, since their
+    neighbors may then have planned paths out of the way. Those which still fail
+    stay where they are. Since that is not the retraction their planned neighbors
+    assumed, those neighbors' paths are then re-checked, and any which are no
+    longer clear are re-planned too (each positioner is searched at most
+    _max_searches times). Past the deadline (if any), searches fail right away.
+
+        collider ... instance of PosCollider, which also supplies the planner settings
+        deadline ... optional time.perf_counter() value, as in PosScheduleStage
+    """
+    _start_offset = 1e-6 # sec, moves are started this far past a timestep, so that PosSweep.quantize() rounds them onto it
+    _max_searches = 3 # max number of times any one positioner is searched, including retries and re-plans
+
+    def __init__(self, collider, deadline=None):
+        self.collider = collider
+        self.deadline = deadline
+        config = collider.config
+        self.timestep = collider.timestep # sec, the planner's unit of time, same as for collision checking
+        self.theta_step = config.get('PLANNER_THETA_STEP', 30.0) # deg, max spacing of theta waypoints
+        self.wait_step = max(1, round(config.get('PLANNER_WAIT_STEP', 0.2) / self.timestep)) # timesteps, duration of a wait move
+        self.max_wait = round(config.get('PLANNER_MAX_WAIT', 5.0) / self.timestep) # timesteps, max total waiting beyond the direct move time
+        self.max_expansions = config.get('PLANNER_MAX_EXPANSIONS', 500) # max lattice nodes expanded per positioner
+        self.reservations = {} # keys: posids, values: PosReservation
+        self.planned_directly = set() # posids whose planned path is simply the direct move, at the release time
+        self._true_moves = {} # keys: (posid, axis, rounded distance), values: PosModel.true_move() results
+        self._static_checks = {} # keys: (posid, start, end, num steps, neighbor, neighbor position), values: whether clear
+
+    def plan(self, start_posintTP, final_posintTP, release_times=None):
+        """Plans paths for all argued positioners.
+
+            start_posintTP ... dict of starting [theta,phi] positions, keys are posids
+            final_posintTP ... dict of target [theta,phi] positions, keys are posids
+            release_times  ... optional dict of earliest start times, keys are posids
+                               (e.g. from annealing, to limit power density)
+
+        Returns a tuple:
+
+            item 0 ... dict with keys = posids, values = lists of move table rows, each
+                       a tuple (prepause, dT, dP). Positioners with no motion have [].
+
+            item 1 ... set of posids for which no path was found
+        """
+        release_times = {} if release_times is None else release_times
+        self.reservations = {}
+        self.planned_directly = set()
+        self._static_checks = {}
+        for posid, posmodel in self.collider.posmodels.items():
+            start = start_posintTP[posid] if posid in start_posintTP else posmodel.expected_current_posintTP
+            self.reservations[posid] = PosReservation(posmodel.trans.posintTP_to_poslocTP(start))
+        lattices = {}
+        for posid in start_posintTP:
+            lattices[posid] = self._lattice(posid, start_posintTP[posid], final_posintTP[posid])
+        moving = [p for p in lattices if lattices[p]['goal'] != (0, 0)]
+        release = {p: math.ceil(round(release_times.get(p, 0.0) / self.timestep, 6)) for p in moving}
+        for posid in moving:
+            self._reserve_retraction(posid, lattices[posid], release[posid])
+        direct = {p: self._move_steps(p, lattices[p]['T'][-1] - lattices[p]['T'][0], lattices[p]['P'][lattices[p]['goal'][1]] - lattices[p]['P'][0])[1] for p in moving}
+        order = sorted(moving, key=lambda p: (-direct[p], p)) # longest moves first, then by posid for repeatability
+        rows = {p: [] for p in start_posintTP}
+        searches = {p: 0 for p in moving}
+        retry = []
+        for queue in [order, retry]:
+            for posid in queue: # note that retry may grow while being iterated over
+                path = self._search(posid, lattices[posid], release[posid], direct[posid])
+                searches[posid] += 1
+                if path is not None:
+                    rows[posid] = self._reserve(posid, lattices[posid], path)
+                    if len(path) == 2:
+                        self.planned_directly.add(posid)
+                    continue
+                if queue is order:
+                    retry.append(posid)
+                stay = [posid] # positioners which will stay where they are (for now)
+                while stay:
+                    stayed = stay.pop()
+                    self.reservations[stayed] = PosReservation((lattices[stayed]['locT'][0], lattices[stayed]['locP'][0]))
+                    for neighbor in sorted(self.collider.pos_neighbors[stayed]):
+                        if rows.get(neighbor) and not self._reservation_is_clear(neighbor):
+                            rows[neighbor] = []
+                            self.planned_directly.discard(neighbor)
+                            stay.append(neighbor)
+                            if searches[neighbor] < self._max_searches:
+                                retry.append(neighbor)
+        unplanned = {p for p in moving if not rows[p]}
+        return rows, unplanned
+
+    def deadline_passed(self):
+        """Returns boolean whether the scheduling deadline (if any) has passed."""
+        return self.deadline is not None and time.perf_counter() > self.deadline
+
+    def _reservation_is_clear(self, posid):
+        """Re-checks the reserved path of posid, from step 0 onward, against the
+        fixed boundaries and the current reservations of its neighbors.
+        """
+        reservation = self.reservations[posid]
+        times = [int(t) for t in reservation.times]
+        tps = reservation.tps
+        segments = zip(tps[:-1], tps[1:], times[:-1], times[1:])
+        return all(self._is_clear(posid, a, b, t0, t1) for a, b, t0, t1 in segments if t1 > t0) and \
+               self._is_clear(posid, tps[-1], tps[-1], times[-1], math.inf)
+
+    def _lattice(self, posid, start_posintTP, final_posintTP):
+        """Returns dict describing the theta and phi waypoints of posid (posintTP),
+        their poslocTP equivalents, and the lattice index of the goal.
+        """
+        posmodel = self.collider.posmodels[posid]
+        trans = posmodel.trans
+        dtdp = trans.delta_posintTP(final_posintTP, start_posintTP, range_wrap_limits='targetable')
+        n_T = max(1, math.ceil(abs(dtdp[pc.T]) / self.theta_step)) if dtdp[pc.T] else 0
+        T = [start_posintTP[pc.T] + dtdp[pc.T] * k / n_T for k in range(n_T + 1)] if n_T else [start_posintTP[pc.T]]
+        P = [start_posintTP[pc.P]]
+        final_P = start_posintTP[pc.P] + dtdp[pc.P]
+        retracted_P = trans.poslocTP_to_posintTP([0, self.collider.Eo_phi])[pc.P] # poslocT=0 is a dummy value
+        for p in [final_P, retracted_P]:
+            if all(abs(p - q) > pc.schedule_checking_numeric_angular_tol for q in P):
+                P.append(p)
+        goal_P = [abs(p - final_P) <= pc.schedule_checking_numeric_angular_tol for p in P].index(True)
+        offsets = trans.posintTP_to_poslocTP([0.0, 0.0])
+        return {'T': T, 'P': P, 'goal': (len(T) - 1, goal_P),
+                'locT': [t + offsets[pc.T] for t in T],
+                'locP': [p + offsets[pc.P] for p in P]}
+
+    def _reserve_retraction(self, posid, lattice, release):
+        """Stores the provisional reservation of a not-yet-planned posid: a phi
+        retraction at step release, if it starts outside the retracted phi.
+        """
+        start = (lattice['locT'][0], lattice['locP'][0])
+        reservation = PosReservation(start)
+        retracted = (start[0], self.collider.Eo_phi)
+        if start[1] < retracted[1]:
+            reservation.append(release, start)
+            reservation.append(release + self._move_steps(posid, 0, retracted[1] - start[1])[0], retracted)
+        self.reservations[posid] = reservation
+
+    def _move_time(self, posid, dT, dP):
+        """Returns the time of a simultaneous move by dT and dP, per PosModel.true_move()."""
+        return max([0.0] + [self._true_move(posid, axis, distance)['move_time'] for axis, distance in [(pc.T, dT), (pc.P, dP)] if distance])
+
+    def _true_move(self, posid, axis, distance):
+        """Returns PosModel.true_move() for a single axis, memoized."""
+        key = (posid, axis, round(distance, 6))
+        if key not in self._true_moves:
+            posmodel = self.collider.posmodels[posid]
+            self._true_moves[key] = posmodel.true_move(axisid=axis, distance=distance, allow_cruise=True, limits=None, init_posintTP=None)
+        return self._true_moves[key]
+
+    def _move_steps(self, posid, dT, dP):
+        """Returns a tuple (number of timesteps in motion, number of timesteps until
+        the next move may start) for a simultaneous move by dT and dP. These are as
+        PosSweep.quantize() will discretize it, given a start just past a timestep.
+        """
+        move_time = self._move_time(posid, dT, dP)
+        if not move_time:
+            return 0, 0
+        moving = max(1, int((move_time + self._start_offset) / self.timestep))
+        return moving, max(moving, math.ceil((move_time + 2 * self._start_offset) / self.timestep))
+
+    def _search(self, posid, lattice, release, direct):
+        """A* search for the earliest collision-free arrival of posid at its goal.
+        Returns the path as a list of (k, j, step) lattice nodes, beginning at
+        (0, 0, release), or None if no path was found.
+        """
+        T, P, goal = lattice['T'], lattice['P'], lattice['goal']
+        horizon = release + direct + self.max_wait
+        def heuristic(k, j):
+            return self._move_steps(posid, T[goal[0]] - T[k], P[goal[1]] - P[j])[1]
+        def loc(k, j):
+            return (lattice['locT'][k], lattice['locP'][j])
+        nodes = [(0, 0, release, None)] # (k, j, step, parent index)
+        heap = [(release + heuristic(0, 0), 0)]
+        closed = set()
+        n_expanded = 0
+        while heap and n_expanded < self.max_expansions and not self.deadline_passed():
+            _, idx = heapq.heappop(heap)
+            k, j, t, _ = nodes[idx]
+            bucket = (k, j, t // self.wait_step)
+            if bucket in closed:
+                continue
+            closed.add(bucket)
+            n_expanded += 1
+            if (k, j) == goal and self._is_clear(posid, loc(k, j), loc(k, j), t, math.inf):
+                path = []
+                while idx is not None:
+                    path.append(nodes[idx][:3])
+                    idx = nodes[idx][3]
+                return path[::-1]
+            successors = [(k, j, (self.wait_step, self.wait_step))]
+            for kk in [k - 1, k + 1]:
+                if 0 <= kk < len(T):
+                    successors.append((kk, j, self._move_steps(posid, T[kk] - T[k], 0)))
+            for jj in range(len(P)):
+                if jj != j:
+                    successors.append((k, jj, self._move_steps(posid, 0, P[jj] - P[j])))
+            if k != goal[0] and not (j == goal[1] and abs(goal[0] - k) == 1): # i.e. not already covered above
+                successors.append((goal[0], goal[1], self._move_steps(posid, T[goal[0]] - T[k], P[goal[1]] - P[j])))
+            for kk, jj, (moving, duration) in successors:
+                tt = t + duration
+                if tt > horizon or (kk, jj, tt // self.wait_step) in closed:
+                    continue
+                if self._is_clear(posid, loc(k, j), loc(kk, jj), t, t + moving) and \
+                        (moving == duration or self._is_clear(posid, loc(kk, jj), loc(kk, jj), t + moving, tt)):
+                    nodes.append((kk, jj, tt, idx))
+                    heapq.heappush(heap, (tt + heuristic(kk, jj), len(nodes) - 1))
+        return None
+
+    def _is_clear(self, posid, a, b, t0, t1):
+        """Checks whether posid, moving linearly from poslocTP a at step t0 to b at
+        step t1, avoids the fixed boundaries and the reservations of its neighbors.
+        With a == b and t1 = math.inf, checks posid parked at a from t0 onward.
+        """
+        collider = self.collider
+        moving = a != b
+        n_moving = t1 - t0 if moving else 0
+        key = (posid, a, b, n_moving)
+        if key not in self._static_checks:
+            self._static_checks[key] = all(collider.spatial_collision_with_fixed(posid, tp) == pc.case.I
+                                           for tp in self._interpolate(a, b, n_moving))
+        if not self._static_checks[key]:
+            return False
+        for neighbor in collider.pos_neighbors[posid]:
+            reservation = self.reservations[neighbor]
+            end = t1 if t1 < math.inf else max(t0, reservation.end_time)
+            if not reservation.is_moving_during(t0, end):
+                key = (posid, a, b, n_moving, neighbor, reservation.tp_at(t0))
+                if key not in self._static_checks:
+                    self._static_checks[key] = all(collider.spatial_collision_between_positioners(posid, neighbor, tp, key[-1]) == pc.case.I
+                                                   for tp in self._interpolate(a, b, n_moving))
+                if not self._static_checks[key]:
+                    return False
+                continue
+            last = None
+            for t in range(t0, end + 1):
+                f = (t - t0) / n_moving if moving else 0.0
+                tp = (a[0] + f * (b[0] - a[0]), a[1] + f * (b[1] - a[1]))
+                pair = (tp, reservation.tp_at(t))
+                if pair != last and collider.spatial_collision_between_positioners(posid, neighbor, pair[0], pair[1]) != pc.case.I:
+                    return False
+                last = pair
+        return True
+
+    @staticmethod
+    def _interpolate(a, b, n):
+        """Returns list of n + 1 evenly spaced positions from a to b."""
+        if not n:
+            return [a]
+        return [(a[0] + i / n * (b[0] - a[0]), a[1] + i / n * (b[1] - a[1])) for i in range(n + 1)]
+
+    def _reserve(self, posid, lattice, path):
+        """Stores the planned path of posid in the reservation table, and returns the
+        corresponding move table rows, as (prepause, dT, dP) tuples. Prepauses are
+        set such that each move starts just past its planned timestep. Each row's
+        distances also make up for the motor step quantization of the rows before
+        it, so that the errors don't accumulate over the path.
+        """
+        T, P = lattice['T'], lattice['P']
+        reservation = PosReservation((lattice['locT'][0], lattice['locP'][0]))
+        rows = []
+        previous_end_time = 0.0
+        quantization_error = [0.0, 0.0]
+        for (k, j, t), (kk, jj, tt) in zip(path[:-1], path[1:]):
+            if (k, j) == (kk, jj):
+                continue
+            reservation.append(t, (lattice['locT'][k], lattice['locP'][j]))
+            reservation.append(t + self._move_steps(posid, T[kk] - T[k], P[jj] - P[j])[0], (lattice['locT'][kk], lattice['locP'][jj]))
+            dtdp = [T[kk] - T[k] + quantization_error[pc.T], P[jj] - P[j] + quantization_error[pc.P]]
+            for axis in [pc.T, pc.P]:
+                if dtdp[axis]:
+                    quantization_error[axis] = dtdp[axis] - self._true_move(posid, axis, dtdp[axis])['distance']
+            start_time = t * self.timestep + self._start_offset
+            rows.append((max(0.0, start_time - previous_end_time), dtdp[pc.T], dtdp[pc.P]))
+            previous_end_time = start_time + self._move_time(posid, dtdp[pc.T], dtdp[pc.P])
+        self.reservations[posid] = reservation
+        return rows
@@ -13,6 +13,26 @@ found_not_registered_str = 'found but not directly resolved (useful for debuggin
 _unregistered_schedule_str = 'unregistered'
 _blank_str = '-'
 
+# numbers which are running totals, and so are added together in merge_latest()
+_summed_numbers = ['n requests',
+                   'n requests accepted',
+                   'n tables achieving requested-and-accepted targets',
+                   'num path adjustment iters',
+                   'num find_collisions calls',
+                   'num neighbor pairs checked',
+                   'num neighbor pairs pruned',
+                   'collision check cache hits',
+                   'collision check cache misses',
+                   'schedule cache hit',
+                   'num combined adjustments prechecked',
+                   'num combined adjustments rejected by precheck',
+                   'num pos planned with waits or detours',
+                   'request_target calc time',
+                   'schedule_moves calc time',
+                   'request + schedule calc time',
+                   'expert_add_table calc time',
+                   ]
+
 class PosSchedStats(object):
     """Collects statistics from runs of the PosSchedule.
 
@@ -73,6 +93,11 @@ class PosSchedStats(object):
         self.unresolved_tables = {}
         self.unresolved_sweeps = {}
         self.final_checked_collision_pairs = {}
+        self.neighbor_pairs = {}
+        self.deadline_degraded = {}
+        self.combined_rescued = {}
+        self.not_planned = {}
+        self.anneal_metrics = {}
         self.strings = {'method':[], 'note':[]}
         self._strings_to_print_first = ['method']
         self._strings_to_print_last = ['note']
@@ -84,6 +109,18 @@ class PosSchedStats(object):
                         final_checks_str:[],
                         'max table move time':[],
                         'num path adjustment iters':[],
+                        'num find_collisions calls':[],
+                        'num neighbor pairs checked':[],
+                        'num neighbor pairs pruned':[],
+                        'collision check cache hits':[],
+                        'collision check cache misses':[],
+                        'schedule cache hit':[],
+                        'num pos degraded by deadline':[],
+                        'num combined adjustments prechecked':[],
+                        'num combined adjustments rejected by precheck':[],
+                        'num pos rescued by combined adjustment':[],
+                        'num pos planned with waits or detours':[],
+                        'num pos not planned':[],
                         'request_target calc time':[],
                         'schedule_moves calc time':[],
                         'request + schedule calc time':[],
@@ -109,6 +146,11 @@ class PosSchedStats(object):
         self.unresolved_tables[self.latest] = {}
         self.unresolved_sweeps[self.latest] = {}
         self.final_checked_collision_pairs[self.latest] = {}
+        self.neighbor_pairs[self.latest] = {}
+        self.deadline_degraded[self.latest] = set()
+        self.combined_rescued[self.latest] = set()
+        self.not_planned[self.latest] = set()
+        self.anneal_metrics[self.latest] = {}
         for key in self.strings:
             self.strings[key].append(_blank_str)
         for key in self.numbers:
@@ -269,6 +311,107 @@ class PosSchedStats(object):
         """Add data recording number of iterations of path adjustment were made."""
         self.numbers['num path adjustment iters'][-1] += iterations
 
+    def add_find_collisions_calls(self, n_calls=1):
+        """Add data recording how many times PosScheduleStage.find_collisions()
+        was called."""
+        self.numbers['num find_collisions calls'][-1] += n_calls
+
+    def add_neighbor_pairs_checked(self, stage_name, n_checked, n_pruned):
+        """Add data recording how many pairs of neighbors were checked in detail
+        for collisions in a given stage, versus how many were pruned beforehand
+        (because their sweep envelopes did not overlap)."""
+        this_dict = self.neighbor_pairs[self.latest]
+        if stage_name not in this_dict:
+            this_dict[stage_name] = {'checked':0, 'pruned':0}
+        this_dict[stage_name]['checked'] += n_checked
+        this_dict[stage_name]['pruned'] += n_pruned
+        self.numbers['num neighbor pairs checked'][-1] += n_checked
+        self.numbers['num neighbor pairs pruned'][-1] += n_pruned
+
+    def add_anneal_metrics(self, stage_name, mode, stage_time, peak):
+        """Add data recording the result of annealing a stage: the anneal mode, the
+        resulting stage time, and the peak number of concurrently moving motors per
+        power supply. If a stage is annealed more than once, the latest is kept."""
+        self.anneal_metrics[self.latest][stage_name] = {'mode': mode, 'time': stage_time, 'peak': peak}
+
+    def add_collision_cache_lookups(self, n_hits, n_misses):
+        """Add data recording how many detailed collision checks were retrieved
+        from the schedule stages' caches, versus how many were computed."""
+        self.numbers['collision check cache hits'][-1] += n_hits
+        self.numbers['collision check cache misses'][-1] += n_misses
+
+    def add_deadline_degraded(self, posid):
+        """Add data recording that a positioner's collision was resolved only by
+        freezing, because the scheduling deadline had passed."""
+        self.deadline_degraded[self.latest].add(posid)
+        self.numbers['num pos degraded by deadline'][-1] = len(self.deadline_degraded[self.latest])
+
+    def add_combined_adjustment_precheck(self, passed):
+        """Add data recording the result of the quick spatial precheck made before
+        proposing a combined (rotation + extension / retraction) path adjustment."""
+        self.numbers['num combined adjustments prechecked'][-1] += 1
+        if not passed:
+            self.numbers['num combined adjustments rejected by precheck'][-1] += 1
+
+    def add_combined_adjustment_rescue(self, posid):
+        """Add data recording that a positioner's collision was resolved by a combined
+        path adjustment, after all the single methods had failed. Such positioners
+        would otherwise have been frozen."""
+        self.combined_rescued[self.latest].add(posid)
+        self.numbers['num pos rescued by combined adjustment'][-1] = len(self.combined_rescued[self.latest])
+
+    def add_planner_results(self, detoured, unplanned):
+        """Add data recording the results of the path planner (anticollision='plan'):
+        the posids whose paths needed waits or detours (rather than just the direct
+        move), and the posids for which no path was found."""
+        self.numbers['num pos planned with waits or detours'][-1] += len(detoured)
+        self.not_planned[self.latest] |= set(unplanned)
+        self.numbers['num pos not planned'][-1] = len(self.not_planned[self.latest])
+
+    def add_schedule_cache_hit(self):
+        """Add data recording that the final move tables were retrieved from the
+        petal's schedule cache, rather than computed."""
+        self.numbers['schedule cache hit'][-1] += 1
+
+    def new_accumulator(self):
+        """Returns a separate stats instance, for a sub-stage to record into from its
+        own thread, without contending on this one. It is enabled only if this one
+        is. Fold its data back in afterward with merge_latest()."""
+        accumulator = PosSchedStats()
+        if self.is_enabled():
+            accumulator.enable()
+        return accumulator
+
+    def merge_latest(self, other):
+        """Merge the latest row of data in other (as from new_accumulator()) into
+        the latest row of this one. Counters are summed, and sets of posids or
+        collision pairs are unioned."""
+        if not self.is_enabled() or not other.is_enabled():
+            return
+        mine, theirs = self.latest, other.latest
+        self.collisions[mine]['found'] |= other.collisions[theirs]['found']
+        for method, pairs in other.collisions[theirs]['resolved'].items():
+            self.collisions[mine]['resolved'][method] = self.collisions[mine]['resolved'].get(method, set()) | pairs
+        for posid, avoidances in other.avoidances[theirs].items():
+            self.avoidances[mine][posid] = self.avoidances[mine].get(posid, []) + avoidances
+        for stage_name, counts in other.neighbor_pairs[theirs].items():
+            this_dict = self.neighbor_pairs[mine].setdefault(stage_name, {'checked':0, 'pruned':0})
+            this_dict['checked'] += counts['checked']
+            this_dict['pruned'] += counts['pruned']
+        for stage_name, colliding_set in other.unresolved[theirs].items():
+            self.unresolved[mine].setdefault(stage_name, set()).update(colliding_set)
+            self.unresolved_tables[mine].setdefault(stage_name, {}).update(other.unresolved_tables[theirs][stage_name])
+            self.unresolved_sweeps[mine].setdefault(stage_name, {}).update(other.unresolved_sweeps[theirs][stage_name])
+        self.anneal_metrics[mine].update(other.anneal_metrics[theirs])
+        self.deadline_degraded[mine] |= other.deadline_degraded[theirs]
+        self.combined_rescued[mine] |= other.combined_rescued[theirs]
+        self.not_planned[mine] |= other.not_planned[theirs]
+        for key in _summed_numbers:
+            self.numbers[key][-1] += other.numbers[key][-1]
+        self.numbers['num pos degraded by deadline'][-1] = len(self.deadline_degraded[mine])
+        self.numbers['num pos rescued by combined adjustment'][-1] = len(self.combined_rescued[mine])
+        self.numbers['num pos not planned'][-1] = len(self.not_planned[mine])
+
     def add_final_collision_check(self, collision_pairs):
         """Add data recording if there were still any bots colliding after a
         final check."""
@@ -304,7 +447,7 @@ class PosSchedStats(object):
         for sched in self.schedule_ids:
             coll = self.collisions[sched]
             summary['resolved total collisions'].append(0)
-            for method in pc.all_adjustment_methods:
+            for method in pc.all_adjustment_methods + pc.combined_adjustment_methods:
                 if method not in summary:
                     summary[method] = []
                 if method in coll['resolved']:
@@ -335,10 +478,16 @@ class PosSchedStats(object):
         data.update(self.numbers)
         data.update(self.summarize_collision_resolutions())
         data.update(self.summarize_unresolved_colliding())
+        data['neighbor pairs checked/pruned by stage'] = [self.neighbor_pairs[sched] for sched in self.schedule_ids]
+        data['pos degraded by deadline'] = [sorted(self.deadline_degraded[sched]) for sched in self.schedule_ids]
+        data['pos rescued by combined adjustment'] = [sorted(self.combined_rescued[sched]) for sched in self.schedule_ids]
+        data['pos not planned'] = [sorted(self.not_planned[sched]) for sched in self.schedule_ids]
+        data['anneal mode/time/peak motors by stage'] = [self.anneal_metrics[sched] for sched in self.schedule_ids]
         nrows = len(next(iter(data.values())))
         safe_divide = lambda a,b: a / b if b else np.inf # avoid divide-by-zero errors
         data['calc: fraction of target requests accepted'] = [safe_divide(data['n requests accepted'][i], data['n requests'][i]) for i in range(nrows)]
         data['calc: fraction of targets achieved (of those accepted)'] = [safe_divide(data['n tables achieving requested-and-accepted targets'][i], data['n requests accepted'][i]) for i in range(nrows)]
+        data['calc: collision check cache hit rate'] = [safe_divide(data['collision check cache hits'][i], data['collision check cache hits'][i] + data['collision check cache misses'][i]) for i in range(nrows)]
         for key in self._strings_to_print_last:
             data.update({key:self.strings[key]})
         stripped_data, stripped_nrows = self._copy_and_strip_null_rows(data)
@@ -1,8 +1,11 @@
 import posconstants as pc
 import posschedulestage
 import posschedstats
+import posplanner
 import time
 import math
+import hashlib
+import collections
 
 # enables debugging code
 DEBUG = False
@@ -31,7 +34,7 @@ class PosSchedule(object):
         self.verbose = verbose
         self.printfunc = self.petal.printfunc
         self._requests = {} # keys: posids, values: target request dictionaries
-        self.stage_order = ['direct', 'debounce_polygons', 'retract', 'rotate', 'extend', 'expert', 'final']
+        self.stage_order = ['direct', 'debounce_polygons', 'retract', 'rotate', 'extend', 'plan', 'expert', 'final']
         self.RRE_stage_order = ['retract', 'rotate', 'extend']
         self.stages = {name:posschedulestage.PosScheduleStage(
                                 collider         = self.collider,
@@ -39,7 +42,8 @@ class PosSchedule(object):
                                 power_supply_map = self.petal.power_supply_map,
                                 verbose          = self.verbose,
                                 printfunc        = self.printfunc,
-                                petal            = self.petal
+                                petal            = self.petal,
+                                name             = name
                             ) for name in self.stage_order}
         self.should_check_petal_boundaries = True # allows you to turn off petal-specific boundary checks for non-petal systems (such as positioner test stands)
         self.should_check_sweeps_continuity = False # if True, inspects all quantized sweeps to confirm well-formed. incurs slowdown, and generally is not needed; more for validating if any changes made to quantize function at a lower level
@@ -47,6 +51,8 @@ class PosSchedule(object):
         self.extra_log_notes = {} # keys = posid, values = strs --- special collection of extra log notes that should be stored, outside of the usual move_tables data tracking (e.g. for empty or motionless positioner special cases)
         self._expert_added_tables_sequence = []  # copy of original sequence in which expert tables were added (for error-recovery cases)
         self._all_requested_posids = {'regular': set(), 'expert': set()}  # every posid that received a request, whether accepted or not
+        self.deadline = None # time.perf_counter() value by which scheduling should be done (see schedule_moves)
+        self._path_adjustment_plan = None # stage waypoints from _schedule_requests_with_path_adjustments, kept for re-planning
 
     @property
     def collider(self):
@@ -71,10 +77,17 @@ class PosSchedule(object):
                                 stats            = self.stats,
                                 power_supply_map = self.petal.power_supply_map,
                                 verbose          = self.verbose,
-                                printfunc        = self.printfunc
+                                printfunc        = self.printfunc,
+                                name             = name
                             ) for name in self.stage_order}
+        self._set_stage_deadlines()
+        self._path_adjustment_plan = None
         return
 
+    def _set_stage_deadlines(self):
+        for stage in self.stages.values():
+            stage.deadline = self.deadline
+
     def request_target(self, posid, uv_type, u, v, log_note='', allow_initial_interference=True):
         """Adds a request to the schedule for a given positioner to move to the
         target position (u,v) or by the target distance (du,dv) in the
@@ -246,8 +259,28 @@ class PosSchedule(object):
                 self._schedule_requests_with_path_adjustments(should_anneal=should_anneal, adjust_requested_only=False)
             elif anticollision == 'adjust_requested_only':
                 self._schedule_requests_with_path_adjustments(should_anneal=should_anneal, adjust_requested_only=True)
+            elif anticollision == 'plan':
+                self._schedule_requests_with_planner(should_anneal=should_anneal)
             else:
                 self._schedule_requests_with_no_path_adjustments(anticollision=anticollision, should_anneal=should_anneal)
+        return self._combine_and_check_final_stage(anticollision, scheduling_timer_start)
+
+    def _replan_moves(self, posids, anticollision, scheduling_timer_start):
+        """Alternative to _schedule_moves(), after requests for posids have been
+        replaced by _handle_schedule_moves_collision(). Only the paths of posids and
+        their neighbors are re-planned (see _replan_path_adjustments). The final
+        stage is then rebuilt and checked exactly as in _schedule_moves().
+        """
+        self._replan_path_adjustments(posids)
+        self.stages['final'].clear()
+        return self._combine_and_check_final_stage(anticollision, scheduling_timer_start)
+
+    def _can_replan_locally(self, anticollision):
+        return anticollision in {'adjust', 'adjust_requested_only'} and not self.expert_mode_is_on() \
+               and self._path_adjustment_plan is not None
+
+    def _combine_and_check_final_stage(self, anticollision, scheduling_timer_start):
+        """Helper for _schedule_moves() and _replan_moves()."""
         self._combine_stages_into_final()
         self.printfunc(f'Scheduling calculation done in {time.perf_counter()-scheduling_timer_start:.3f} sec')
         finalcheck_timer_start = time.perf_counter()
@@ -276,6 +309,30 @@ class PosSchedule(object):
                 colliding_sweeps, collision_pairs = c, p # for readability
         return colliding_sweeps, collision_pairs, finalcheck_timer_start, final
 
+    def _schedule_moves_from_cache(self, cache, key, scheduling_timer_start):
+        """Helper function for schedule_moves(). Looks up previously computed final
+        move tables for key. On a hit, the tables are loaded into the final stage
+        and re-checked for collisions. Returns the same tuple as _schedule_moves(),
+        or None if there was no usable cached result.
+        """
+        tables = cache.get(key)
+        if tables is None:
+            return None
+        final = self.stages['final']
+        for table in tables.values():
+            final.add_table(table)
+        self.printfunc(f'Scheduling loaded from cache in {time.perf_counter()-scheduling_timer_start:.3f} sec')
+        finalcheck_timer_start = time.perf_counter()
+        colliding_sweeps, _, collision_pairs = self._check_final_stage(msg_prefix='Cached schedule')
+        if colliding_sweeps:
+            self.printfunc('Cached schedule rejected due to collisions. Rescheduling from scratch.')
+            cache.discard(key)
+            self._reinit_stages()
+            return None
+        if self.stats.is_enabled():
+            self.stats.add_schedule_cache_hit()
+        return colliding_sweeps, collision_pairs, finalcheck_timer_start, final
+
     def _handle_schedule_moves_collision(self, colliding_sweeps, collision_pairs):
         """
         This function handles the case when, after all the collision mitigation strategies have run, there are still collisions
@@ -290,6 +347,9 @@ class PosSchedule(object):
 
         If resolve_non_zeno is True, then all colliding devices will have targets replaced with dummies and they will be temporarily disabled.
         Again, after this function exits, the planning for the remaining devices will be re-run.
+
+        Returns the set of posids whose targets were replaced. The caller is responsible for re-running
+        the planning, either locally around those posids (see _replan_moves) or from scratch.
         """
         zeno_posids = set()
         colliding_posids = [posid for posid in colliding_sweeps]
@@ -306,7 +366,7 @@ class PosSchedule(object):
             stats_enabled = self.stats.is_enabled()
             if stats_enabled:
                 self.stats.sub_request_accepted()
-            self._reinit_stages() # clear out old move tables - starting over
+            return zeno_posids
         else:
             colliding = set(colliding_sweeps)
             self.printfunc(self.get_details_str(colliding, label='colliding'))
@@ -324,10 +384,9 @@ class PosSchedule(object):
                 stats_enabled = self.stats.is_enabled()
                 if stats_enabled:
                     self.stats.sub_request_accepted()
-                self._reinit_stages() # clear out old move tables - starting over
-        return
+                return set(colliding_posids)
 
-    def schedule_moves(self, anticollision='freeze', should_anneal=True):
+    def schedule_moves(self, anticollision='freeze', should_anneal=True, deadline=None):
         """Executes the scheduling algorithm upon the stored list of move requests.
 
         A single move table is generated for each positioner that has a request
@@ -358,6 +417,14 @@ class PosSchedule(object):
                         "get out of the way" moves will be done on unrequested
                         neighbors.
 
+          'plan'    ... Paths are planned one positioner at a time, searching
+                        over theta, phi, and time to avoid the paths already
+                        planned for neighbors (see PosPlanner). Positioners
+                        for which no path is found stay where they are. Any
+                        remaining collisions are resolved by freezing. This
+                        setting is an alternative to 'adjust' for gross
+                        retargeting moves.
+
         If there were ANY pre-existing move tables in the list (for example, hard-
         stop seeking tables directly added by an expert user or expert function),
         then the requests list is ignored. The only changes to move tables are
@@ -367,6 +434,13 @@ class PosSchedule(object):
 
         The boolean flag should_anneal controls whether or not to spread out
         the move density in time.
+
+        The optional deadline is a time budget (in seconds) for the calculation.
+        Once it is exceeded, path adjustment stops exploring the non-freezing
+        methods, and any remaining collisions are resolved by freezing. The
+        affected posids are recorded in stats ('pos degraded by deadline').
+        Scheduling may still run somewhat past the deadline, since freezing and
+        the final collision checks are always completed.
         """
 
         self._schedule_moves_initialize_logging(anticollision)
@@ -404,17 +478,50 @@ class PosSchedule(object):
 
 
         scheduling_timer_start = time.perf_counter()
-        do_schedule = True
+        self.deadline = scheduling_timer_start + float(deadline) if deadline is not None else None
+        self._set_stage_deadlines()
+        cache = getattr(self.petal, 'schedule_cache', None)
+        cache_key = None
+        cached = None
+        if cache and cache.is_enabled() and not self.expert_mode_is_on():
+            self._fill_enabled_but_nonmoving_with_dummy_requests()
+            cache_key = cache.key(self, anticollision, should_anneal)
+            cached = self._schedule_moves_from_cache(cache, cache_key, scheduling_timer_start)
+        do_schedule = cached is None
+        if cached:
+            colliding_sweeps, collision_pairs, finalcheck_timer_start, final = cached
+        num_passes = 0
+        replan_posids = set() # after a collision repair, re-plan locally around these
+        repaired_posids = set()
 
         while do_schedule:
-            colliding_sweeps, collision_pairs, finalcheck_timer_start, final = \
-                self._schedule_moves(anticollision, should_anneal, scheduling_timer_start)
+            if replan_posids:
+                colliding_sweeps, collision_pairs, finalcheck_timer_start, final = \
+                    self._replan_moves(replan_posids, anticollision, scheduling_timer_start)
+            else:
+                colliding_sweeps, collision_pairs, finalcheck_timer_start, final = \
+                    self._schedule_moves(anticollision, should_anneal, scheduling_timer_start)
+            num_passes += 1
 #            if DEBUG:
 #                colliding_sweeps, collision_pairs = self._possibly_induce_scheduling_error(colliding_sweeps, collision_pairs, anticollision)
             if not collision_pairs or not anticollision:
                 do_schedule = False
             else:
-                self._handle_schedule_moves_collision(colliding_sweeps, collision_pairs)
+                replaced = self._handle_schedule_moves_collision(colliding_sweeps, collision_pairs)
+                if self._can_replan_locally(anticollision) and not replaced <= repaired_posids:
+                    replan_posids = replaced
+                    repaired_posids |= replaced
+                else:
+                    replan_posids = set()
+                    self._reinit_stages() # clear out old move tables - starting over
+
+        deadline_passed = final.deadline_passed()
+        if deadline_passed:
+            self.printfunc(f'Scheduling deadline of {deadline} sec was exceeded. Any collisions found afterward were resolved by freezing.')
+            if self.stats.is_enabled():
+                self.stats.add_note(f'deadline {deadline} sec exceeded')
+        if cache_key and num_passes == 1 and not collision_pairs and not deadline_passed:
+            cache.put(cache_key, final.move_tables) # only clean single-pass results, i.e. no zeno / disabling repairs to requests, nor deadline degradations
 
         self.printfunc(f'Final collision checks done in {time.perf_counter()-finalcheck_timer_start:.3f} sec')
         self._schedule_moves_check_final_sweeps_continuity()
@@ -435,6 +542,8 @@ class PosSchedule(object):
             anim_tables = {}
         for table in self.move_tables.values():
             table.strip()
+        if self.collider.warm_start:
+            self._schedule_moves_take_snapshot()
         self._schedule_moves_store_requests_info()
         self._schedule_moves_finish_logging(anim_tables)
 
@@ -780,93 +889,202 @@ class PosSchedule(object):
         The move tables may include adjustments of paths to avoid collisions.
         """
         debounced_start_posintTP = self._debounce_polygons()
-        stats_enabled = self.stats.is_enabled()
-        start_posintTP = {name: {} for name in self.RRE_stage_order}
-        desired_final_posintTP = {name: {} for name in self.RRE_stage_order}
-        dtdp = {name: {} for name in self.RRE_stage_order}
-        retracted_poslocP = self.collider.Eo_phi  # Ei would also be safe, but unnecessary in most cases. Costs more time and power to get to
-        no_auto_adjust = set()
+        plan = {'start_posintTP': {name: {} for name in self.RRE_stage_order},
+                'desired_final_posintTP': {name: {} for name in self.RRE_stage_order},
+                'dtdp': {name: {} for name in self.RRE_stage_order},
+                'should_anneal': should_anneal,
+                'adjust_requested_only': adjust_requested_only,
+                'no_auto_adjust': set()}
         if adjust_requested_only:
-            no_auto_adjust = {posid for posid, req in self._requests.items() if req['is_dummy']}
+            plan['no_auto_adjust'] = {posid for posid, req in self._requests.items() if req['is_dummy']}
         for posid, request in self._requests.items():
-            # Some care is taken here to use only delta and add functions
-            # provided by PosTransforms to ensure that range wrap limits are
-            # always safely handled from stage to stage.
-            posmodel = self.petal.posmodels[posid]
-            trans = posmodel.trans
             if posid in debounced_start_posintTP:
                 this_start_posintTP = debounced_start_posintTP[posid]
             else:
                 this_start_posintTP = request['start_posintTP']
-            this_start_poslocTP = trans.posintTP_to_poslocTP(this_start_posintTP)
-            start_posintTP['retract'][posid] = this_start_posintTP
-            if this_start_poslocTP[pc.P] > self.collider.Eo_phi or request['start_posintTP'] == request['targt_posintTP']:
-                retracted_posintP = start_posintTP['retract'][posid][pc.P]
-            else:
-                retracted_posintTP = trans.poslocTP_to_posintTP([0, retracted_poslocP])  # poslocT=0 is a dummy value
-                retracted_posintP = retracted_posintTP[pc.P]
-            desired_final_posintTP['retract'][posid] = [request['start_posintTP'][pc.T], retracted_posintP]
-            desired_final_posintTP['rotate'][posid] = [request['targt_posintTP'][pc.T], retracted_posintP]
-            desired_final_posintTP['extend'][posid] = request['targt_posintTP']
-            def calc_dtdp(name, posid):
-                tp_start = start_posintTP[name][posid]
-                tp_final = desired_final_posintTP[name][posid]
-                return trans.delta_posintTP(tp_final, tp_start, range_wrap_limits='targetable')
-            def calc_next_tp(last_name, posid):
-                last_tp = start_posintTP[last_name][posid]
-                this_dtdp = dtdp[last_name][posid]
-                return trans.addto_posintTP(last_tp, this_dtdp, range_wrap_limits='targetable')
-            dtdp['retract'][posid] = calc_dtdp('retract', posid)
-            start_posintTP['rotate'][posid] = calc_next_tp('retract', posid)
-            dtdp['rotate'][posid] = calc_dtdp('rotate', posid)
-            start_posintTP['extend'][posid] = calc_next_tp('rotate', posid)
-            dtdp['extend'][posid] = calc_dtdp('extend', posid)
+            self._plan_path_adjustment_waypoints(plan, posid, this_start_posintTP)
         for name in self.RRE_stage_order:
-            stage = self.stages[name]
-            stage.initialize_move_tables(start_posintTP[name], dtdp[name])
-#           stage.move_tables = stage.rewrite_zeno_move_tables(stage.move_tables)
-            not_the_last_stage = name != self.RRE_stage_order[-1]
-            if should_anneal:
+            self._schedule_path_adjustment_stage(plan, name)
+        self._path_adjustment_plan = plan # retained for any localized re-planning (see _replan_path_adjustments)
+
+    def _schedule_requests_with_planner(self, should_anneal=True):
+        """Gathers data from requests dictionary and populates the 'plan' stage
+        with motion paths from start to finish, as found by PosPlanner. With
+        should_anneal, the planner doesn't start any positioner sooner than its
+        annealed start time for a direct move, so power density is limited just as
+        in the 'direct' stage. Any collisions remaining (e.g. from the small final
+        creep and antibacklash moves, which the planner does not model) are then
+        resolved by forced freezing.
+        """
+        debounced_start_posintTP = self._debounce_polygons()
+        start_posintTP = {}
+        final_posintTP = {}
+        dtdp = {}
+        for posid, request in self._requests.items():
+            start_posintTP[posid] = debounced_start_posintTP.get(posid, request['start_posintTP'])
+            final_posintTP[posid] = request['targt_posintTP']
+            trans = self.petal.posmodels[posid].trans
+            dtdp[posid] = trans.delta_posintTP(final_posintTP[posid], start_posintTP[posid], range_wrap_limits='targetable')
+        stage = self.stages['plan']
+        release_times = {}
+        if should_anneal:
+            stage.initialize_move_tables(start_posintTP, dtdp)
+            stage.anneal_tables(suppress_automoves=False, mode=self.petal.anneal_mode)
+            release_times = {posid: table.get_prepause(0) for posid, table in stage.move_tables.items()}
+        planner = posplanner.PosPlanner(self.collider, deadline=self.deadline)
+        planned_rows, unplanned = planner.plan(start_posintTP, final_posintTP, release_times)
+        stage.initialize_move_tables(start_posintTP, {posid: [0.0, 0.0] for posid in start_posintTP})
+        for posid, rows in planned_rows.items():
+            table = stage.move_tables[posid]
+            for i, (prepause, dT, dP) in enumerate(rows):
+                table.set_prepause(i, prepause)
+                table.set_move(i, pc.T, dT)
+                table.set_move(i, pc.P, dP)
+        if unplanned:
+            self.printfunc(f'Planner found no path for {len(unplanned)} positioner(s): {sorted(unplanned)}')
+        if self.stats.is_enabled():
+            detoured = {posid for posid, rows in planned_rows.items() if rows} - planner.planned_directly
+            self.stats.add_planner_results(detoured, unplanned)
+        self._direct_stage_conditioning(stage=stage, should_freeze=True, should_anneal=False)
+
+    def _replan_path_adjustments(self, posids):
+        """Re-plans the 'retract', 'rotate', and 'extend' stages locally, after the
+        requests for posids have changed. In each stage, the tables of posids and
+        their immediate neighbors are re-initialized, and collisions around them are
+        re-resolved. Positioners frozen along the way are carried into the following
+        stages' re-planning. All other tables and sweeps are kept as-is.
+        """
+        plan = self._path_adjustment_plan
+        first_name = self.RRE_stage_order[0]
+        region = self.stages[first_name]._hops_from(posids, 1) & set(self._requests)
+        self.printfunc(f'Re-planning paths locally for {len(region)} positioners around {sorted(posids)}')
+        if plan['adjust_requested_only']:
+            plan['no_auto_adjust'] |= {posid for posid in region if self._requests[posid]['is_dummy']}
+        for posid in region:
+            self._plan_path_adjustment_waypoints(plan, posid, plan['start_posintTP'][first_name][posid])
+        replan = set(region)
+        restarted = set()
+        for name in self.RRE_stage_order:
+            if name != first_name:
+                for posid in replan - restarted:
+                    plan['start_posintTP'][name][posid] = self._path_adjustment_next_start(plan, name, posid)
+                    plan['dtdp'][name][posid] = self._path_adjustment_dtdp(plan, name, posid)
+            restarted = self._schedule_path_adjustment_stage(plan, name, posids=replan)
+            replan |= restarted
+
+    def _plan_path_adjustment_waypoints(self, plan, posid, start_posintTP):
+        """Helper for path adjustment scheduling. Fills in plan's starting positions,
+        desired final positions, and deltas in each of the retract, rotate, and
+        extend stages for posid, per its request.
+        """
+        # Some care is taken here to use only delta and add functions
+        # provided by PosTransforms to ensure that range wrap limits are
+        # always safely handled from stage to stage.
+        request = self._requests[posid]
+        trans = self.petal.posmodels[posid].trans
+        start, desired, dtdp = plan['start_posintTP'], plan['desired_final_posintTP'], plan['dtdp']
+        retracted_poslocP = self.collider.Eo_phi  # Ei would also be safe, but unnecessary in most cases. Costs more time and power to get to
+        this_start_poslocTP = trans.posintTP_to_poslocTP(start_posintTP)
+        start['retract'][posid] = start_posintTP
+        if this_start_poslocTP[pc.P] > self.collider.Eo_phi or request['start_posintTP'] == request['targt_posintTP']:
+            retracted_posintP = start['retract'][posid][pc.P]
+        else:
+            retracted_posintTP = trans.poslocTP_to_posintTP([0, retracted_poslocP])  # poslocT=0 is a dummy value
+            retracted_posintP = retracted_posintTP[pc.P]
+        desired['retract'][posid] = [request['start_posintTP'][pc.T], retracted_posintP]
+        desired['rotate'][posid] = [request['targt_posintTP'][pc.T], retracted_posintP]
+        desired['extend'][posid] = request['targt_posintTP']
+        for name in self.RRE_stage_order:
+            if name != self.RRE_stage_order[0]:
+                start[name][posid] = self._path_adjustment_next_start(plan, name, posid)
+            dtdp[name][posid] = self._path_adjustment_dtdp(plan, name, posid)
+
+    def _path_adjustment_dtdp(self, plan, name, posid):
+        trans = self.petal.posmodels[posid].trans
+        tp_start = plan['start_posintTP'][name][posid]
+        tp_final = plan['desired_final_posintTP'][name][posid]
+        return trans.delta_posintTP(tp_final, tp_start, range_wrap_limits='targetable')
+
+    def _path_adjustment_next_start(self, plan, name, posid):
+        trans = self.petal.posmodels[posid].trans
+        last_name = self.RRE_stage_order[self.RRE_stage_order.index(name) - 1]
+        last_tp = plan['start_posintTP'][last_name][posid]
+        this_dtdp = plan['dtdp'][last_name][posid]
+        return trans.addto_posintTP(last_tp, this_dtdp, range_wrap_limits='targetable')
+
+    def _schedule_path_adjustment_stage(self, plan, name, posids=None):
+        """Helper for path adjustment scheduling. Initializes move tables of stage
+        name per plan, finds collisions, and adjusts paths to resolve them. Any posids
+        frozen in the process have their start positions in the next stage updated
+        in plan.
+
+        By default, all tables in the stage are (re-)initialized. Alternatively, argue
+        a set of posids to re-initialize only their tables. Then only they and their
+        immediate neighbors are checked for collisions, and all other tables and
+        sweeps in the stage are kept as-is.
+
+        Returns set of posids whose start positions in the next stage were updated.
+        """
+        stats_enabled = self.stats.is_enabled()
+        stage = self.stages[name]
+        not_the_last_stage = name != self.RRE_stage_order[-1]
+        if posids is None:
+            stage.initialize_move_tables(plan['start_posintTP'][name], plan['dtdp'][name])
+            if plan['should_anneal']:
                 stage.anneal_tables(suppress_automoves=not_the_last_stage, mode=self.petal.anneal_mode)
-            if self.verbose:
-                self.printfunc(f'posschedule: finding collisions for {len(stage.move_tables)} positioners, trying {name}')
-                self.printfunc('Posschedule first move table: \n' + str(list(stage.move_tables.values())[0].for_collider()))
-            colliding_sweeps, all_sweeps = stage.find_collisions(stage.move_tables)
-            stage.store_collision_finding_results(colliding_sweeps, all_sweeps)
-            attempts_sequence = ['off','on','forced','forced_recursive'] # these are used as freezing arg to adjust_path()
-            while stage.colliding and attempts_sequence:
-                freezing = attempts_sequence.pop(0)
-                for posid in sorted(stage.colliding.copy()): # sort is for repeatability (since stage.colliding is an unordered set, and so path adjustments would otherwise get processed in variable order from run to run). the copy() call is redundant with sorted(), but left there for the sake of clarity, that need to be looping on a copy of *some* kind
-                    if posid in stage.colliding: # because it may have been resolved already when a *neighbor* got previously adjusted
-                        adjusted, frozen = stage.adjust_path(posid, freezing=freezing, do_not_move=no_auto_adjust)
-                        for p in frozen:
-                            if not_the_last_stage: # i.e. some next stage exists
-                                # must set next stage to begin from the newly-frozen position
-                                adjusted_table_data = stage.move_tables[p].for_schedule()
-                                adjusted_t = start_posintTP[name][p][pc.T] + adjusted_table_data['net_dT'][-1]
-                                adjusted_p = start_posintTP[name][p][pc.P] + adjusted_table_data['net_dP'][-1]
-                                next_stage_idx = self.RRE_stage_order.index(name) + 1
-                                next_name = self.RRE_stage_order[next_stage_idx]
-                                start_posintTP[next_name][p] = [adjusted_t,adjusted_p]
-                                dtdp[next_name][p] = calc_dtdp(next_name, p)
-                if stats_enabled:
-                    self.stats.add_to_num_adjustment_iters(1)
-            if stage.colliding:
-                self.printfunc('Error: During ' + name.upper() + ' stage of move scheduling (see PosSchedule.py), the positioners ' + str([posid for posid in stage.colliding]) + ' had collision(s) that were NOT resolved. This means there is a bug somewhere in the code that needs to be found and fixed. If this move is executed on hardware, these two positioners will collide!')
-                self.printfunc('The move table(s) for these are:')
-                for posid in stage.colliding:
-                    for n in self.RRE_stage_order:
-                        stage_str = str(posid) + ': ' + n.upper()
-                        if posid in self.stages[n].move_tables:
-                            self.printfunc(stage_str)
-                            self.stages[n].move_tables[posid].display(self.printfunc)
-                        elif n == name:
-                            self.printfunc(stage_str + ' --> no move table found')
-                if stats_enabled:
-                    sorted_colliding = sorted(stage.colliding) # just for human ease of reading the values
-                    colliding_tables = {posid:stage.move_tables[posid] for posid in sorted_colliding}
-                    colliding_sweeps = {posid:stage.sweeps[posid] for posid in sorted_colliding}
-                    self.stats.add_unresolved_colliding_at_stage(name, sorted_colliding, colliding_tables, colliding_sweeps)
+            tables_to_check = stage.move_tables
+        else:
+            stage.initialize_move_tables({p: plan['start_posintTP'][name][p] for p in posids},
+                                         {p: plan['dtdp'][name][p] for p in posids}, update_only=True)
+            if plan['should_anneal']:
+                stage.anneal_tables(suppress_automoves=not_the_last_stage, mode=self.petal.anneal_mode, posids=posids)
+            tables_to_check = {p: stage.move_tables[p] for p in stage._hops_from(posids, 1) if p in stage.move_tables}
+        if self.verbose:
+            self.printfunc(f'posschedule: finding collisions for {len(tables_to_check)} positioners, trying {name}')
+            self.printfunc('Posschedule first move table: \n' + str(list(tables_to_check.values())[0].for_collider()))
+        colliding_sweeps, all_sweeps = stage.find_collisions(tables_to_check)
+        stage.store_collision_finding_results(colliding_sweeps, all_sweeps)
+        restarted = set()
+        attempts_sequence = ['off','on','forced','forced_recursive'] # these are used as freezing arg to adjust_path()
+        while stage.colliding and attempts_sequence:
+            freezing = attempts_sequence.pop(0)
+            no_auto_adjust = plan['no_auto_adjust']
+            if self.collider.resolution_order == 'time':
+                frozen = stage.adjust_paths_by_time(freezing=freezing, do_not_move=no_auto_adjust)
+            elif self.collider.parallel_components and freezing != 'forced_recursive':
+                frozen = stage.adjust_paths_by_component(freezing=freezing, do_not_move=no_auto_adjust)
+            else:
+                frozen = stage.adjust_paths(sorted(stage.colliding), freezing=freezing, do_not_move=no_auto_adjust) # sort is for repeatability (since stage.colliding is an unordered set, and so path adjustments would otherwise get processed in variable order from run to run)
+            for p in sorted(frozen):
+                if not_the_last_stage: # i.e. some next stage exists
+                    # must set next stage to begin from the newly-frozen position
+                    adjusted_table_data = stage.move_tables[p].for_schedule()
+                    adjusted_t = plan['start_posintTP'][name][p][pc.T] + adjusted_table_data['net_dT'][-1]
+                    adjusted_p = plan['start_posintTP'][name][p][pc.P] + adjusted_table_data['net_dP'][-1]
+                    next_stage_idx = self.RRE_stage_order.index(name) + 1
+                    next_name = self.RRE_stage_order[next_stage_idx]
+                    plan['start_posintTP'][next_name][p] = [adjusted_t,adjusted_p]
+                    plan['dtdp'][next_name][p] = self._path_adjustment_dtdp(plan, next_name, p)
+                    restarted.add(p)
+            if stats_enabled:
+                self.stats.add_to_num_adjustment_iters(1)
+        if stage.colliding:
+            self.printfunc('Error: During ' + name.upper() + ' stage of move scheduling (see PosSchedule.py), the positioners ' + str([posid for posid in stage.colliding]) + ' had collision(s) that were NOT resolved. This means there is a bug somewhere in the code that needs to be found and fixed. If this move is executed on hardware, these two positioners will collide!')
+            self.printfunc('The move table(s) for these are:')
+            for posid in stage.colliding:
+                for n in self.RRE_stage_order:
+                    stage_str = str(posid) + ': ' + n.upper()
+                    if posid in self.stages[n].move_tables:
+                        self.printfunc(stage_str)
+                        self.stages[n].move_tables[posid].display(self.printfunc)
+                    elif n == name:
+                        self.printfunc(stage_str + ' --> no move table found')
+            if stats_enabled:
+                sorted_colliding = sorted(stage.colliding) # just for human ease of reading the values
+                colliding_tables = {posid:stage.move_tables[posid] for posid in sorted_colliding}
+                colliding_sweeps = {posid:stage.sweeps[posid] for posid in sorted_colliding}
+                self.stats.add_unresolved_colliding_at_stage(name, sorted_colliding, colliding_tables, colliding_sweeps)
+        return restarted
 
     def _make_dummy_request(self, posid, lognote='generated by path adjustment scheduler for enabled but untargeted positioner'):
         posmodel = self.petal.posmodels[posid]
@@ -1011,8 +1229,9 @@ class PosSchedule(object):
         for name in self.stage_order:
             stage = self.stages[name]
             if stage != final:
-                stage.equalize_table_times()
-                for posid,table in stage.move_tables.items():
+                tables = {posid: table.copy() for posid, table in stage.move_tables.items()} # copies keep stage tables intact (and unpadded), for any later re-planning
+                stage.equalize_table_times(tables)
+                for posid,table in tables.items():
                     if posid not in final.move_tables:
                         final.add_table(table)
                     else:
@@ -1045,6 +1264,22 @@ class PosSchedule(object):
             assert False, err_str  # 2020-11-16 [JHS] put a PDB entry point in rather than assert, so I can inspect memory next time this happens online
         return colliding_sweeps, all_sweeps, collision_pairs
 
+    def _schedule_moves_take_snapshot(self):
+        """Helper function for schedule_moves(). Stores the positioners' clearances
+        at the end of the scheduled moves in the collider, for warm-starting the
+        next schedule (see PosCollider.take_snapshot).
+        """
+        poslocTP = {}
+        for posid in self.collider.posids:
+            posmodel = self.petal.posmodels[posid]
+            if posid in self.move_tables:
+                table = self.move_tables[posid]
+                net = table.for_schedule()
+                poslocTP[posid] = [table.init_poslocTP[pc.T] + net['net_dT'][-1], table.init_poslocTP[pc.P] + net['net_dP'][-1]]
+            else:
+                poslocTP[posid] = posmodel.expected_current_poslocTP
+        self.collider.take_snapshot(poslocTP)
+
     def _schedule_moves_check_final_sweeps_continuity(self):
         """Helper function for schedule_moves()."""
         final = self.stages['final']
@@ -1189,5 +1424,89 @@ class PosSchedule(object):
         s += f'({uv_str})'
         return s
 
+class ScheduleCache(object):
+    """Bounded, least-recently-used store of final move tables computed by
+    PosSchedule.schedule_moves(). Intended for operations where the same set of
+    requests is scheduled repeatedly from the same starting positions (e.g. test
+    sequences, or re-sending after an aborted move).
+
+    Entries are keyed on the canonicalized requests (including start positions),
+    anticollision and annealing settings, and a fingerprint of all positioner
+    calibration / settings values and collider config. Any change to these misses
+    the cache. A hit is still re-checked for collisions before use.
+
+        size ... max number of stored schedules, 0 disables caching
+    """
+
+    # state keys which change during normal operation, without affecting scheduling
+    ignored_state_keys = {'POS_T', 'POS_P', 'CURRENT_LOG_BASENAME', 'MOVE_CMD', 'MOVE_VAL1', 'MOVE_VAL2',
+                          'TOTAL_MOVE_SEQUENCES', 'TOTAL_CRUISE_MOVES_T', 'TOTAL_CRUISE_MOVES_P',
+                          'TOTAL_CREEP_MOVES_T', 'TOTAL_CREEP_MOVES_P', 'TOTAL_LIMIT_SEEKS_T', 'TOTAL_LIMIT_SEEKS_P',
+                          'LAST_MEAS_OBS_X', 'LAST_MEAS_OBS_Y', 'LAST_MEAS_PEAK', 'LAST_MEAS_FWHM',
+                          'LOG_NOTE', 'CALIB_NOTE', 'EXPOSURE_ID', 'EXPOSURE_ITER',
+                          'OBS_X', 'OBS_Y', 'PTL_X', 'PTL_Y', 'PTL_Z', 'FLAGS', 'POSTSCRIPT'}
+    angle_decimals = 6 # rounding of request angles (deg) when forming keys
+
+    def __init__(self, size=0):
+        self.size = size
+        self.hits = 0
+        self.misses = 0
+        self.rejected = 0
+        self._entries = collections.OrderedDict()
+
+    def is_enabled(self):
+        return self.size > 0
+
+    def key(self, schedule, anticollision, should_anneal):
+        """Returns the cache key for the current requests in schedule.
+        """
+        d = self.angle_decimals
+        requests = tuple((posid, tuple(round(x, d) for x in req['start_posintTP']),
+                          tuple(round(x, d) for x in req['targt_posintTP']), req['is_dummy'])
+                         for posid, req in sorted(schedule._requests.items()))
+        petal = schedule.petal
+        anneal_mode = petal.anneal_mode
+        settings = (anticollision, should_anneal, anneal_mode, pc.anneal_density[anneal_mode])
+        return (requests, settings, self.fingerprint(petal))
+
+    def fingerprint(self, petal):
+        """Returns hash of all scheduling-relevant positioner and collider settings.
+        """
+        h = hashlib.md5()
+        for posid in sorted(petal.posmodels):
+            values = petal.posmodels[posid].state._val
+            h.update(repr(sorted((k, v) for k, v in values.items() if k not in self.ignored_state_keys)).encode())
+        h.update(repr(sorted(petal.collider.config.items())).encode())
+        return h.hexdigest()
+
+    def get(self, key):
+        """Returns dict of copies of the cached move tables for key, or None.
+        """
+        if key not in self._entries:
+            self.misses += 1
+            return None
+        self.hits += 1
+        self._entries.move_to_end(key)
+        return {posid: table.copy() for posid, table in self._entries[key].items()}
+
+    def put(self, key, move_tables):
+        self._entries[key] = {posid: table.copy() for posid, table in move_tables.items()}
+        self._entries.move_to_end(key)
+        while len(self._entries) > self.size:
+            self._entries.popitem(last=False)
+
+    def discard(self, key):
+        """Removes entry for key, e.g. if it failed verification when used.
+        """
+        if self._entries.pop(key, None) is not None:
+            self.rejected += 1
+
+    def clear(self):
+        self._entries.clear()
+
+    def get_info(self):
+        return {'size': self.size, 'entries': len(self._entries), 'hits': self.hits,
+                'misses': self.misses, 'rejected': self.rejected}
+
 POS_DISABLED_MSG = 'Positioner is disabled.'
 BOTH_AXES_LOCKED_MSG = 'Both theta and phi axes are locked.'
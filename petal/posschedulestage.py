@@ -1,6 +1,9 @@
 import posconstants as pc
 import posmovetable
 import math
+import time
+import heapq
+from concurrent.futures import ThreadPoolExecutor
 
 class PosScheduleStage(object):
     """This class encapsulates the concept of a 'stage' of the fiber
@@ -12,7 +15,8 @@ class PosScheduleStage(object):
         stats            ... instance of posschedstats for this petal
         power_supply_map ... dict where key = power supply id, value = set of posids attached to that supply
     """
-    def __init__(self, collider, stats, power_supply_map=None, verbose=False, printfunc=None, petal=None):
+    def __init__(self, collider, stats, power_supply_map=None, verbose=False, printfunc=None, petal=None, name=''):
+        self.name = name # stage name, as in posschedule.stage_order (used when recording stats)
         self.collider = collider # poscollider instance
         self.move_tables = {} # keys: posids, values: posmovetable instances
         self.start_posintTP = {} # keys: posids, values: initial positions at start of stage
@@ -25,10 +29,17 @@ class PosScheduleStage(object):
         self._phi_max_jog_A = 45 # deg, maximum distance to temporarily shift phi when doing path adjustments
         self._phi_max_jog_B = 90
         self._max_jog = self._assign_max_jog_values() # collection of all the max jog options above
+        self._combined_precheck_samples = 16 # max number of neighbor positions to test in _combined_adjustment_precheck()
         self.sweep_continuity_check_stepsize = 4.0 # deg, see PosSweep.check_continuity function
         self.verbose = verbose
         self.printfunc = printfunc
         self.petal_debug = petal.petal_debug if hasattr(petal, 'petal_debug') else {}
+        self._check_cache = {} # keys: (table keys, skip), values: list of PosSweeps resulting from that collision check (see find_collisions)
+        self._sweep_cache = {} # keys: table keys, values: quantized PosSweeps without collision checking
+        self._envelope_cache = {} # keys: table keys, values: sweep envelopes (see PosCollider.sweep_envelopes)
+        self._write_hops = 2 # neighbor hops over which adjust_path() may store collision results (see conflict_components)
+        self._read_hops = 3 # neighbor hops over which adjust_path() may read tables (see conflict_components)
+        self.deadline = None # time.perf_counter() value, after which adjust_path() only freezes (see PosSchedule.schedule_moves)
 
     def initialize_move_tables(self, start_posintTP, dtdp, update_only=False):
         """Generates basic move tables for each positioner, starting at position
@@ -179,6 +190,15 @@ class PosScheduleStage(object):
         else:
             self.move_tables[this_posid] = move_table
 
+    def clear(self):
+        '''Removes all move tables, sweeps, and collision status from the stage.
+        Collision check caches are kept.
+        '''
+        self.move_tables = {}
+        self.start_posintTP = {}
+        self.sweeps = {}
+        self.colliding = set()
+
     def del_table(self, posid):
         '''Deletes a move table and associated sweep data. This may leave the
         state of self.colliding out of date, until the next find_collisions() call.
@@ -187,7 +207,7 @@ class PosScheduleStage(object):
             if posid in d:
                 del d[posid]
 
-    def anneal_tables(self, suppress_automoves=False, mode='filled'):
+    def anneal_tables(self, suppress_automoves=False, mode='filled', posids=None):
         """Adjusts move table timing, to attempt to reduce peak power consumption
         of the overall array.
 
@@ -201,16 +221,41 @@ class PosScheduleStage(object):
 
             mode ... 'filled' --> try to most efficiently fill time with moves
                      'ramped' --> try to ramp up/down the power (takes more time)
+                     'packed' --> minimize stage time, with no more motors running
+                                  concurrently on each power supply than 'filled'
+                                  would have (at the same density)
+
+            posids ... by default, all the stage's tables are annealed. Alternatively, argue
+                       a set of posids (e.g. after re-initializing just their tables) to
+                       anneal only theirs, fitting them in among the others' existing
+                       timing (see _anneal_among).
 
         If anneal_time is less than the time it takes to execute the longest move
         table, then that longer execution time will be used instead of anneal_time.
+
+        In 'packed' mode, each power supply's cap is the peak number of concurrently
+        moving motors of the 'filled' arrangement. The supply is split into that many
+        "lanes", in which moves run one after another. Tables are assigned longest
+        first, each to the lane which frees up earliest (a min-heap of lane end times).
+        This is the LPT rule for minimizing makespan on parallel machines, within 4/3
+        of optimal. Wherever that is still longer than the 'filled' arrangement, the
+        latter is kept. The stage time is the longest resulting makespan (or longest
+        table). Then for each supply, the fewest lanes which still fit within that
+        stage time are used, to lower peak power wherever it costs no time.
+
+        Returns dict with the resulting stage time ('time') and the peak number of
+        concurrently moving motors per power supply ('peak'). These are also recorded
+        in stats. A stage with no motion gives time 0.0 and peaks of 0, and is not
+        recorded.
         """
         assert mode in pc.anneal_density, f'unrecognized anneal mode {mode}'
+        if posids is not None:
+            return self._anneal_among(posids, suppress_automoves, mode)
         times = {posid: table.total_time(suppress_automoves=suppress_automoves)
                  for posid, table in self.move_tables.items()
                  if not(table.is_motionless)}
         if not times:
-            return
+            return self._anneal_metrics(times)
         sorted_times = sorted(times.values())[::-1]
         sorted_posids = sorted(times, key=lambda k: times[k])[::-1]
         orig_max_time = max(sorted_times)
@@ -218,27 +263,11 @@ class PosScheduleStage(object):
         anneal_window = max(anneal_window, orig_max_time)  # for case of very large outlier
 
         if mode == 'filled':
-            def first_within(x, vec):
-                for i, test in enumerate(vec):
-                    if test <= x:
-                        return i
-                return None
             for map_posids in self._power_supply_map.values():
                 posids = [p for p in sorted_posids if p in map_posids]  # maintains sorted-by-time order
-                times2 = [sorted_times[i] for i in range(len(sorted_posids)) if sorted_posids[i] in map_posids]
-                prepause = 0.0
-                while posids:
-                    open_time = anneal_window - prepause
-                    i = first_within(open_time, times2)
-                    if i == None:
-                        prepause = 0.0
-                    else:
-                        posid = posids[i]
-                        self.move_tables[posid].insert_new_row(0)
-                        self.move_tables[posid].set_prepause(0, prepause)
-                        prepause += times2[i]
-                        del posids[i]
-                        del times2[i]
+                for posid, prepause in zip(posids, self._fill_window([times[p] for p in posids], anneal_window)):
+                    self.move_tables[posid].insert_new_row(0)
+                    self.move_tables[posid].set_prepause(0, prepause)
 
         elif mode == 'ramped':
             resolution = 0.1 # sec
@@ -253,30 +282,297 @@ class PosScheduleStage(object):
                     self.move_tables[posid].set_prepause(0, prepause)
                     which = -1 if which == 0 else 0
 
-    def equalize_table_times(self):
+        elif mode == 'packed':
+            supply_posids = [[p for p in sorted_posids if p in map_posids] for map_posids in self._power_supply_map.values()]  # maintains sorted-by-time order
+            supply_posids = [posids for posids in supply_posids if posids]
+            supply_durations = [[times[p] for p in posids] for posids in supply_posids]
+            filled = [self._fill_window(durations, anneal_window) for durations in supply_durations]
+            caps = [self._max_concurrent([(start, start + duration) for start, duration in zip(starts, durations)])
+                    for starts, durations in zip(filled, supply_durations)]
+            makespans = [min(self._pack_lanes(durations, cap)[0], max(start + duration for start, duration in zip(starts, durations)))
+                         for durations, starts, cap in zip(supply_durations, filled, caps)]
+            stage_time = max([orig_max_time] + makespans)
+            for posids, durations, starts, cap in zip(supply_posids, supply_durations, filled, caps):
+                if self._pack_lanes(durations, cap)[0] <= stage_time:
+                    lo, hi = 1, cap # fewest lanes which still fit within stage_time, to minimize peak power
+                    while lo < hi:
+                        mid = (lo + hi) // 2
+                        if self._pack_lanes(durations, mid)[0] <= stage_time:
+                            hi = mid
+                        else:
+                            lo = mid + 1
+                    starts = self._pack_lanes(durations, lo)[1]
+                for posid, prepause in zip(posids, starts):
+                    self.move_tables[posid].insert_new_row(0)
+                    self.move_tables[posid].set_prepause(0, prepause)
+
+        metrics = self._anneal_metrics(times)
+        if self.stats.is_enabled():
+            self.stats.add_anneal_metrics(self.name, mode, metrics['time'], metrics['peak'])
+        return metrics
+
+    def _anneal_among(self, posids, suppress_automoves, mode):
+        """Anneals the tables of posids, while keeping all other (already annealed)
+        tables in the stage as they are. Their moves are taken to run from their first
+        prepause to their end.
+
+        The window is the one anneal_tables() would use for the whole stage, except in
+        'packed' mode, where it is the stage's current time (so as not to lengthen it).
+        Each table, longest first, is started at whichever of time 0 or the end of
+        another move on its power supply gives the fewest concurrently moving motors
+        over its duration, while still ending within the window (earliest on ties).
+
+        Returns the same metrics as anneal_tables(), for the whole stage.
+        """
+        times = {posid: table.total_time(suppress_automoves=suppress_automoves)
+                 for posid, table in self.move_tables.items()
+                 if not(table.is_motionless)}
+        new_times = {posid: times[posid] for posid in posids if posid in times}
+        intervals = {posid: (self.move_tables[posid].get_prepause(0), end)
+                     for posid, end in times.items() if posid not in new_times}
+        times.update({posid: end - start for posid, (start, end) in intervals.items()})
+        if not new_times:
+            return self._anneal_metrics(times)
+        longest_new = max(new_times.values())
+        if mode == 'packed':
+            window = max([longest_new] + [end for start, end in intervals.values()])
+        else:
+            window = max(sum(times.values()) / len(times) / pc.anneal_density[mode], max(times.values()))
+        for posid in sorted(new_times, key=lambda k: new_times[k])[::-1]:
+            duration = new_times[posid]
+            supply_posids = set().union(*[p for p in self._power_supply_map.values() if posid in p])
+            others = [interval for p, interval in intervals.items() if p in supply_posids]
+            candidates = sorted({0.0}.union(end for start, end in others if end + duration <= window))
+            def peak(start):
+                return self._max_concurrent([(max(a, start), b) for a, b in others if a < start + duration and b > start])
+            start = min(candidates, key=lambda t: (peak(t), t))
+            self.move_tables[posid].insert_new_row(0)
+            self.move_tables[posid].set_prepause(0, start)
+            intervals[posid] = (start, start + duration)
+        metrics = self._anneal_metrics(times)
+        if self.stats.is_enabled():
+            self.stats.add_anneal_metrics(self.name, mode, metrics['time'], metrics['peak'])
+        return metrics
+
+    @staticmethod
+    def _fill_window(durations, window):
+        """Assigns durations (sorted longest first) start times the 'filled' way: moves
+        are chained one after another, each time taking the longest which still fits
+        before window ends, and starting a new chain at 0 when none does. Returns the
+        list of start times.
+        """
+        remaining = list(range(len(durations)))
+        starts = [None] * len(durations)
+        prepause = 0.0
+        while remaining:
+            open_time = window - prepause
+            fitting = [i for i in remaining if durations[i] <= open_time]
+            if not fitting:
+                prepause = 0.0
+            else:
+                i = fitting[0]
+                starts[i] = prepause
+                prepause += durations[i]
+                remaining.remove(i)
+        return starts
+
+    @staticmethod
+    def _max_concurrent(intervals):
+        """Returns the peak number of overlapping (start, end) intervals."""
+        edges = sorted([(start, 1) for start, end in intervals] + [(end, -1) for start, end in intervals]) # ends sort before starts at equal times
+        concurrent = 0
+        peak = 0
+        for _, change in edges:
+            concurrent += change
+            peak = max(peak, concurrent)
+        return peak
+
+    @staticmethod
+    def _pack_lanes(durations, n_lanes):
+        """Assigns durations (sorted longest first) to n_lanes lanes, each to the lane
+        which frees up earliest. Returns the makespan and the list of start times.
+        """
+        lanes = [0.0] * n_lanes # heap of lane end times
+        starts = []
+        for duration in durations:
+            start = heapq.heappop(lanes)
+            starts.append(start)
+            heapq.heappush(lanes, start + duration)
+        return max(lanes), starts
+
+    def _anneal_metrics(self, times):
+        """Returns dict with the stage time and the peak number of concurrently moving
+        motors on each power supply, for annealed tables with move durations times
+        (dict keyed by posid, not including the annealing prepauses).
+        """
+        intervals = {posid: (self.move_tables[posid].get_prepause(0), self.move_tables[posid].get_prepause(0) + duration)
+                     for posid, duration in times.items()}
+        peak = {supply: self._max_concurrent([intervals[p] for p in intervals if p in map_posids])
+                for supply, map_posids in self._power_supply_map.items()}
+        return {'time': max([end for start, end in intervals.values()], default=0.0), 'peak': peak}
+
+    def equalize_table_times(self, tables=None):
         """Makes all move tables in the stage have an equal total time length,
         by adding in post-pauses wherever necessary.
+
+        Alternatively, argue a dict of tables (keyed by posid) to be equalized in
+        the stage's place, e.g. copies of its tables. The stage's own tables and
+        sweeps are then left as-is.
         """
-        if not self.move_tables:
+        padding_own_tables = tables is None
+        if padding_own_tables:
+            tables = self.move_tables
+        if not tables:
             return
         times = {}
-        for posid,table in self.move_tables.items():
+        for posid,table in tables.items():
             postprocessed = table.for_schedule()
             times[posid] = postprocessed['net_time'][-1]
         max_time = max(times.values())
-        for posid,table in self.move_tables.items():
+        for posid,table in tables.items():
             equalizing_pause = max_time - times[posid]
             if equalizing_pause:
                 idx = table.n_rows
                 table.insert_new_row(idx)
                 table.set_postpause(idx,equalizing_pause)
-                if self.sweeps: # because no collision checking is performed if anticollsion=None
+                if self.sweeps and padding_own_tables: # because no collision checking is performed if anticollsion=None
                     if posid in self.sweeps.keys():
                         self.sweeps[posid].extend(self.collider.timestep, max_time)
         if self.verbose:
             self.printfunc(f'posschedulestage: move time after annealing = {max_time}')
         return max_time
 
+    def adjust_paths(self, posids, freezing='on', do_not_move=None):
+        """Calls adjust_path() for each of posids in turn, skipping any that are no longer
+        colliding (e.g. since they were resolved when a neighbor got adjusted). Returns
+        the set of posids that were frozen.
+        """
+        frozen = set()
+        for posid in posids:
+            if posid in self.colliding:
+                frozen.update(self.adjust_path(posid, freezing=freezing, do_not_move=do_not_move)[1])
+        return frozen
+
+    def adjust_paths_by_time(self, freezing='on', do_not_move=None):
+        """Alternative to adjust_paths(), which resolves collisions in order of their
+        collision times rather than by posid. The earliest collision is resolved first,
+        from a priority queue. After each adjustment, only those positioners whose
+        collision results may have been re-stored (the adjusted ones and their neighbors)
+        are re-queued, at their updated collision times. This includes collisions newly
+        introduced by the adjustment, which can thus be resolved within the same pass
+        rather than requiring another one. Each posid is adjusted at most once per call.
+
+        Ties in collision time are broken by posid, for repeatability. Returns the set of
+        posids that were frozen.
+        """
+        frozen = set()
+        attempted = set()
+        queue = [(self.sweeps[posid].collision_time, posid) for posid in self.colliding]
+        heapq.heapify(queue)
+        while queue:
+            collision_time, posid = heapq.heappop(queue)
+            if posid in attempted or posid not in self.colliding:
+                continue
+            if self.sweeps[posid].collision_time != collision_time:
+                continue # stale entry, since superseded by a re-queued one
+            attempted.add(posid)
+            adjusted, newly_frozen = self.adjust_path(posid, freezing=freezing, do_not_move=do_not_move)
+            frozen.update(newly_frozen)
+            affected = adjusted.union(*[self.collider.pos_neighbors[p] for p in adjusted])
+            for p in sorted(affected.intersection(self.colliding).difference(attempted)):
+                heapq.heappush(queue, (self.sweeps[p].collision_time, p))
+        return frozen
+
+    def adjust_paths_by_component(self, freezing='on', do_not_move=None):
+        """Like adjust_paths() on sorted(self.colliding), but first partitions the colliding
+        positioners into independent conflict components (see conflict_components). Each
+        component is resolved in its own sub-stage, in parallel threads when collider setting
+        COLLISION_THREADS > 1, and the results are then merged back in component order.
+
+        Since no path adjustment in one component can see or alter the tables of another,
+        the results are identical to adjust_paths(). That does not hold for freezing =
+        'forced_recursive', whose follow-on freezes can spread arbitrarily far, so that case
+        is not supported here.
+        """
+        assert freezing != 'forced_recursive', 'forced_recursive freezing must be done serially, with adjust_paths()'
+        components = self.conflict_components(self.colliding)
+        if len(components) <= 1:
+            return self.adjust_paths(sorted(self.colliding), freezing=freezing, do_not_move=do_not_move)
+        substages = [self._substage(self._hops_from(component, self._read_hops)) for component in components]
+        def resolve(i):
+            return substages[i].adjust_paths(components[i], freezing=freezing, do_not_move=do_not_move)
+        threads = min(self.collider.collision_threads, len(components))
+        if threads > 1:
+            with self.collider.releasing_gil(), ThreadPoolExecutor(max_workers=threads, thread_name_prefix='posschedulestage') as pool:
+                frozen_sets = list(pool.map(resolve, range(len(components))))
+        else:
+            frozen_sets = [resolve(i) for i in range(len(components))]
+        for component, substage in zip(components, substages):
+            written = self._hops_from(component, self._write_hops)
+            self.move_tables.update({p: table for p, table in substage.move_tables.items() if p in written})
+            self.sweeps.update({p: sweep for p, sweep in substage.sweeps.items() if p in written})
+            self.colliding = self.colliding.difference(written).union(substage.colliding.intersection(written))
+            self.stats.merge_latest(substage.stats)
+        self._clear_lingering_collisions()
+        return set().union(*frozen_sets)
+
+    def conflict_components(self, posids):
+        """Partitions posids into groups which can be resolved independently by adjust_path().
+
+        Adjusting one positioner's path may alter the tables of it and its immediate neighbors,
+        and store re-checked collision results for positioners up to _write_hops away. The
+        re-checks read tables up to _read_hops away. So two colliding positioners interact
+        only if they are within 1 + _read_hops or 2 * _write_hops of each other (by
+        collider.pos_neighbors).
+
+        Returns a list of sorted lists of posids, ordered by their first elements.
+        """
+        max_hops = max(1 + self._read_hops, 2 * self._write_hops)
+        posids = set(posids)
+        parent = {p: p for p in posids}
+        def root(p):
+            while parent[p] != p:
+                parent[p] = parent[parent[p]]
+                p = parent[p]
+            return p
+        for p in sorted(posids):
+            for q in self._hops_from({p}, max_hops) & posids:
+                parent[root(q)] = root(p)
+        components = {}
+        for p in posids:
+            components.setdefault(root(p), []).append(p)
+        return sorted(sorted(component) for component in components.values())
+
+    def _hops_from(self, posids, hops):
+        """Returns set of posids, plus all positioners within that many hops of them."""
+        found = set(posids)
+        frontier = set(posids)
+        for i in range(hops):
+            frontier = {n for p in frontier for n in self.collider.pos_neighbors[p]} - found
+            found.update(frontier)
+        return found
+
+    def _substage(self, posids):
+        """Returns a new stage, containing only the argued posids' tables, starting positions,
+        and collision status. It also gets the sweeps of those posids and their immediate
+        neighbors (which store_collision_finding_results() may read). It shares collider
+        and check caches with this one. It records stats into its own accumulator (see
+        PosSchedStats.new_accumulator), so that threaded sub-stages don't contend on the
+        counters. Merge them back after the sub-stage is done.
+        """
+        sub = PosScheduleStage(self.collider, self.stats.new_accumulator(), power_supply_map=self._power_supply_map,
+                               verbose=self.verbose, printfunc=self.printfunc, name=self.name)
+        sub.petal_debug = self.petal_debug
+        sub.move_tables = {p: self.move_tables[p] for p in posids if p in self.move_tables}
+        sub.start_posintTP = {p: self.start_posintTP[p] for p in posids if p in self.start_posintTP}
+        sub.sweeps = {p: self.sweeps[p] for p in self._hops_from(posids, 1) if p in self.sweeps}
+        sub.colliding = self.colliding.intersection(posids)
+        sub._check_cache = self._check_cache
+        sub._sweep_cache = self._sweep_cache
+        sub._envelope_cache = self._envelope_cache
+        sub.deadline = self.deadline
+        return sub
+
     def adjust_path(self, posid, freezing='on', do_not_move=None):
         """Adjusts move paths for posid to avoid collision. If the positioner
         has no collision, then no adjustment is made.
@@ -323,6 +619,22 @@ class PosScheduleStage(object):
         resolved by more forced freezing. This is intended as the final adjustment method,
         to definitively prevent any collisions including side-effects.
 
+        If the stage's deadline has passed, the path adjustment options are skipped, and
+        only freezing is tried (nothing, if freezing == 'off'). Such posids are recorded in
+        stats as degraded by the deadline.
+
+        With collider setting COMBINED_ADJUSTMENTS = True, the combined methods (rotation
+        followed by extension or retraction, see _propose_path_adjustment) are tried after
+        all the single methods, before freezing. Positioners whose collision gets resolved
+        by one of them are recorded in stats as rescued by combined adjustment.
+
+        With collider setting PARALLEL_ADJUSTMENT = True, the proposals for all the single
+        non-freezing methods are generated up front, and their collision checks run together
+        in one batch (see prefetch_collisions). The methods are then still evaluated in priority
+        order, with the first successful one accepted, so results are identical to the serial
+        case. Combined methods and freezing are only proposed once the single methods have
+        all failed, as in the serial case.
+
         The timing of a neighbor's motion path may be adjusted as well by this
         function, but not the geometric path that the neighbor follows.
 
@@ -342,10 +654,26 @@ class PosScheduleStage(object):
             methods = pc.nonfreeze_adjustment_methods
         else:
             methods = pc.all_adjustment_methods
+        if self.collider.combined_adjustments and len(methods) > 1:
+            methods = pc.nonfreeze_adjustment_methods + pc.combined_adjustment_methods + methods[len(pc.nonfreeze_adjustment_methods):]
+        if len(methods) > 1 and self.deadline_passed():
+            methods = [] if freezing == 'off' else ['freeze']
+            if stats_enabled:
+                self.stats.add_deadline_degraded(posid)
+        proposals = {}
+        if self.collider.parallel_adjustment and len(methods) > 1:
+            proposals = {method: self._propose_path_adjustment(posid, method, do_not_move)
+                         for method in methods if method in pc.nonfreeze_adjustment_methods}
+            self.prefetch_collisions([tables for tables in proposals.values() if tables])
         for method in methods:
             collision_neighbor = self.sweeps[posid].collision_neighbor
-            proposed_tables = self._propose_path_adjustment(posid, method, do_not_move)
+            if method in proposals:
+                proposed_tables = proposals[method]
+            else:
+                proposed_tables = self._propose_path_adjustment(posid, method, do_not_move)
 #           proposed_tables = self.rewrite_zeno_move_tables(proposed_tables)
+            if not proposed_tables and method in pc.combined_adjustment_methods:
+                continue # most are screened out by their precheck, no need to call find_collisions
             colliding_sweeps, all_sweeps = self.find_collisions(proposed_tables)
             should_accept = not(colliding_sweeps) or freezing in {'forced','forced_recursive'}
             should_accept &= any(proposed_tables) # nothing to accept if no proposed tables were generated
@@ -376,6 +704,8 @@ class PosScheduleStage(object):
                         collision_resolved = True
                     if collision_resolved:
                         self.stats.add_collisions_resolved(posid, method, {old_collision_id})
+                        if method in pc.combined_adjustment_methods:
+                            self.stats.add_combined_adjustment_rescue(posid)
 
                 # store results
                 old_colliding = self.colliding # note how sequence here emphasizes that this must occur before store_collision_finding_results(), which affects self.colliding. in a perfect world, I would re-factor functionally to remove the state-dependence [JHS]
@@ -408,6 +738,11 @@ class PosScheduleStage(object):
                 break # note indentation level of this return statement is essential. it breaks out of the methods for loop. do not remove again!
         return adjusted, frozen
 
+    def deadline_passed(self):
+        """Returns boolean whether the scheduling deadline (if any) has passed.
+        """
+        return self.deadline is not None and time.perf_counter() > self.deadline
+
     def find_collisions(self, move_tables, skip=0):
         """Identifies any collisions that would be induced by executing a collection
         of move tables.
@@ -435,6 +770,25 @@ class PosScheduleStage(object):
         If positioner A collides with a fixed boundary, or with a disabled neighbor
         positioner B, then the returned collisions dict only contains the sweep of A.
 
+        All the detailed checks are made in one batch, by PosCollider.spacetime_collisions()
+        (which may run them in parallel threads, see COLLISION_THREADS).
+
+        Results of the detailed checks are cached within the stage, keyed on the contents
+        of the tables (see _table_key), so that when re-checking after a path adjustment,
+        only those pairs with a changed table on either side are recomputed.
+
+        Before the detailed spacetime check of any pair of neighbors, their sweep envelopes
+        are compared (see PosCollider.sweep_envelopes). Pairs whose envelopes do not overlap
+        cannot possibly collide, and are pruned from further checking. Their sweeps are still
+        included in the 2nd dict. Pruning can be turned off with collider setting
+        PRUNE_NEIGHBOR_PAIRS = False.
+
+        With collider setting WARM_START_PRUNING = True, pairs (and fixed boundaries) are
+        first compared against the clearances stored at the end of the previous schedule
+        (see PosCollider.take_snapshot). If the clearance exceeds the max possible closing
+        displacement of the two tables by WARM_START_MARGIN, the pair is pruned without
+        computing envelopes. This makes scheduling of small correction moves much cheaper.
+
         If a positioner has collisions with multiple other postioners / fixed boundaries,
         then only the first collision event in time is included in the returned collisions
         dict.
@@ -443,31 +797,30 @@ class PosScheduleStage(object):
         moving positioners, then all three of those positioners' sweeps would still
         appear in the return dictionary.
         """
-        already_checked = {posid:set() for posid in self.collider.posids}
+        gathered = self._gather_checks(move_tables, skip)
+        checks, events, table_keys = gathered['checks'], gathered['events'], gathered['table_keys']
         colliding_sweeps = {posid:set() for posid in self.collider.posids}
         all_sweeps = {}
-        for posid in move_tables:
-            table_A = move_tables[posid]
-            for neighbor in self.collider.pos_neighbors[posid]:
-                if neighbor not in already_checked[posid]:
-                    table_B = move_tables[neighbor] if neighbor in move_tables else self._get_or_generate_table(neighbor)
-                    pospos_sweeps = self.collider.spacetime_collision_between_positioners(
-                                            posid, table_A.init_poslocTP, table_A.for_collider(),
-                                            neighbor, table_B.init_poslocTP, table_B.for_collider(),
-                                            skip=skip)
-                    all_sweeps.update({posid:pospos_sweeps[0], neighbor:pospos_sweeps[1]})
-                    for sweep in pospos_sweeps:
-                        if sweep.collision_case != pc.case.I:
-                            colliding_sweeps[sweep.posid].add(sweep)
-                    already_checked[posid].add(neighbor)
-                    already_checked[neighbor].add(posid)
-            for fixed_neighbor in self.collider.fixed_neighbor_cases[posid]:
-                posfix_sweep = self.collider.spacetime_collision_with_fixed(
-                                       posid, table_A.init_poslocTP, table_A.for_collider(),
-                                       skip=skip)[0] # index 0 to immediately retrieve from the one-element list this function returns
-                all_sweeps.update({posid:posfix_sweep}) # don't worry --- if pospos colliding sweep takes precedence, this will be appropriately replaced again below
-                if posfix_sweep.collision_case != pc.case.I:
-                    colliding_sweeps[posid].add(posfix_sweep)
+        n_cache_misses = len(checks)
+        n_cache_hits = sum(1 for kind, _ in events if kind == 'check') - n_cache_misses
+        results = dict(zip(checks, self.collider.spacetime_collisions(list(checks.values()), skip=skip)))
+        for key, sweeps in results.items():
+            self._check_cache[key] = [sweep.copy() for sweep in sweeps] # copies, since returned sweeps may later be altered (e.g. when freezing)
+        for kind, item in events:
+            if kind == 'pruned':
+                for p in item:
+                    if p not in all_sweeps:
+                        if table_keys[p] not in self._sweep_cache:
+                            self._sweep_cache[table_keys[p]] = self.collider.make_sweep(*gathered['args'](p))
+                        all_sweeps[p] = self._sweep_cache[table_keys[p]].copy()
+                continue
+            if item not in results:
+                results[item] = [sweep.copy() for sweep in self._check_cache[item]]
+            sweeps = results[item]
+            all_sweeps.update({sweep.posid:sweep for sweep in sweeps}) # for fixed checks, don't worry --- if pospos colliding sweep takes precedence, this will be appropriately replaced again below
+            for sweep in sweeps:
+                if sweep.collision_case != pc.case.I:
+                    colliding_sweeps[sweep.posid].add(sweep)
         multiple_collisions = {posid for posid in colliding_sweeps if len(colliding_sweeps[posid]) > 1}
         for posid in multiple_collisions:
             first_collision_time = math.inf
@@ -478,8 +831,114 @@ class PosScheduleStage(object):
             colliding_sweeps[posid] = {first_sweep}
         colliding_sweeps = {posid:colliding_sweeps[posid].pop() for posid in colliding_sweeps if colliding_sweeps[posid]} # remove set structure from elements, and remove empty elements
         all_sweeps.update(colliding_sweeps)
+        if self.stats.is_enabled():
+            self.stats.add_find_collisions_calls(1)
+            if self.name:
+                self.stats.add_neighbor_pairs_checked(self.name, gathered['n_checked'], gathered['n_pruned'])
+                self.stats.add_collision_cache_lookups(n_cache_hits, n_cache_misses)
         return colliding_sweeps, all_sweeps
 
+    def prefetch_collisions(self, move_tables_list, skip=0):
+        """Runs the detailed collision checks for several alternative collections of
+        move tables, in one batch via PosCollider.spacetime_collisions() (which may
+        run them in parallel threads, see COLLISION_THREADS). Results go into the
+        stage's check cache, so that subsequent calls to find_collisions() on any of
+        the collections are answered from it. Nothing else about the stage changes.
+
+            move_tables_list ... list of dicts, each like the move_tables argument
+                                 to find_collisions()
+            skip ... as in find_collisions()
+        """
+        checks = {}
+        for move_tables in move_tables_list:
+            checks.update(self._gather_checks(move_tables, skip)['checks'])
+        results = self.collider.spacetime_collisions(list(checks.values()), skip=skip)
+        for key, sweeps in zip(checks, results):
+            self._check_cache[key] = sweeps
+
+    def _gather_checks(self, move_tables, skip=0):
+        """Walks the neighbor pairs and fixed boundaries of move_tables, in the order
+        of find_collisions. Pairs are pruned by the collider's warm start snapshot (see
+        PosCollider.take_snapshot) or by sweep envelope where possible. Returns
+        a dict with:
+
+            'checks' ... keys: check keys, values: argument tuples for
+                         PosCollider.spacetime_collisions(), for those checks not
+                         yet in the stage's cache
+            'events' ... in order of iteration, either ('check', check key) or
+                         ('pruned', posids of the pair)
+            'table_keys' ... keys: posids, values: table keys (see _table_key)
+            'args' ... function(posid), giving the collider's arguments for its sweep
+            'n_checked', 'n_pruned' ... counts of neighbor pairs
+        """
+        already_checked = {posid:set() for posid in self.collider.posids}
+        should_prune = self.collider.prune_pairs
+        snapshot = self.collider.snapshot if self.collider.warm_start else None
+        displacements = {} # keys: posids, values: max displacements from snapshot positions (see PosCollider.max_displacement)
+        tables = {} # keys: posids, values: tables used for checking (including generated ones for neighbors without move tables)
+        collider_tables = {} # keys: posids, values: tables in the format for the collider
+        table_keys = {} # keys: posids, values: table keys (see _table_key)
+        n_checked, n_pruned = 0, 0
+        checks = {} # keys: check keys, values: argument tuples for PosCollider.spacetime_collisions(), for checks not yet in cache
+        events = [] # in order of original iteration, either ('check', check key) or ('pruned', posids of the pair)
+        def register(p, table):
+            tables[p] = table
+            collider_tables[p] = table.for_collider()
+            table_keys[p] = self._table_key(p, table.init_poslocTP, collider_tables[p])
+        def args(p):
+            return (p, tables[p].init_poslocTP, collider_tables[p])
+        def displacement(p):
+            if p not in displacements:
+                if p not in snapshot['poslocTP']:
+                    displacements[p] = math.inf
+                else:
+                    table = collider_tables[p]
+                    T, P = [tables[p].init_poslocTP[0]], [tables[p].init_poslocTP[1]]
+                    for i in range(table['nrows']):
+                        T.append(T[-1] + table['dT'][i])
+                        P.append(P[-1] + table['dP'][i])
+                    displacements[p] = self.collider.max_displacement(p, snapshot['poslocTP'][p], (min(T), max(T)), (min(P), max(P)))
+            return displacements[p]
+        def warm_start_prunes(posid, neighbor=None):
+            clearance = self.collider.snapshot_clearance(posid, neighbor)
+            if clearance is None:
+                return False
+            closing = displacement(posid) + (displacement(neighbor) if neighbor else 0.0)
+            return clearance - closing > self.collider.warm_start_margin
+        def add_check(key, posids):
+            events.append(('check', key))
+            if key not in self._check_cache and key not in checks:
+                checks[key] = sum([args(p) for p in posids], ())
+        for posid in move_tables:
+            register(posid, move_tables[posid])
+            for neighbor in self.collider.pos_neighbors[posid]:
+                if neighbor not in already_checked[posid]:
+                    if neighbor not in tables:
+                        register(neighbor, move_tables[neighbor] if neighbor in move_tables else self._get_or_generate_table(neighbor))
+                    already_checked[posid].add(neighbor)
+                    already_checked[neighbor].add(posid)
+                    if snapshot and warm_start_prunes(posid, neighbor):
+                        events.append(('pruned', (posid, neighbor)))
+                        n_pruned += 1
+                        continue
+                    if should_prune:
+                        for p in (posid, neighbor):
+                            if table_keys[p] not in self._envelope_cache:
+                                self._envelope_cache[table_keys[p]] = self.collider.sweep_envelopes(*args(p))
+                        if not self.collider.envelopes_may_collide(self._envelope_cache[table_keys[posid]], self._envelope_cache[table_keys[neighbor]]):
+                            events.append(('pruned', (posid, neighbor)))
+                            n_pruned += 1
+                            continue
+                    add_check((table_keys[posid], table_keys[neighbor], skip), (posid, neighbor))
+                    n_checked += 1
+            if snapshot and self.collider.fixed_neighbor_cases[posid] and warm_start_prunes(posid):
+                events.append(('pruned', (posid,)))
+                continue
+            for fixed_neighbor in self.collider.fixed_neighbor_cases[posid]:
+                add_check((table_keys[posid], skip), (posid,))
+        return {'checks': checks, 'events': events, 'table_keys': table_keys, 'args': args,
+                'n_checked': n_checked, 'n_pruned': n_pruned}
+
     def store_collision_finding_results(self, colliding_sweeps, all_sweeps):
         """Stores sweep data as-generated by find_collisions method.
         """
@@ -492,18 +951,24 @@ class PosScheduleStage(object):
         now_not_colliding = all_checked.difference(now_colliding)
         self.colliding = self.colliding.union(now_colliding)
         self.colliding = self.colliding.difference(now_not_colliding)
-        # check for special case of lingering incorrect colliding status (no move table therefore wasn't registered as resolved)
+        self._clear_lingering_collisions(colliding_sweeps)
+        if self.stats.is_enabled():
+            found = {self._collision_id(posid, sweep.collision_neighbor) for posid, sweep in colliding_sweeps.items()}
+            self.stats.add_collisions_found(found)
+
+    def _clear_lingering_collisions(self, colliding_sweeps=None):
+        """Checks for special case of lingering incorrect colliding status (no move table
+        therefore wasn't registered as resolved). Any such posids are also removed from the
+        optional colliding_sweeps dict.
+        """
         no_table_but_in_colliding = {posid for posid in self.colliding if posid not in self.move_tables}
         for posid in no_table_but_in_colliding:
             n = self.sweeps[posid].collision_neighbor
             if n and self.sweeps[n].collision_neighbor != posid: # i.e., neighbor thinks this collision has been resolved
                 self.sweeps[posid].clear_collision()
                 self.colliding.remove(posid)
-                if posid in colliding_sweeps:
+                if colliding_sweeps and posid in colliding_sweeps:
                     colliding_sweeps.pop(posid)
-        if self.stats.is_enabled():
-            found = {self._collision_id(posid, sweep.collision_neighbor) for posid, sweep in colliding_sweeps.items()}
-            self.stats.add_collisions_found(found)
 
     def sweeps_continuity_check(self):
         """Returns set of posids for any whose sweeps were found to be discontinous.
@@ -546,6 +1011,12 @@ class PosScheduleStage(object):
              'freeze'      ... Positioner is halted prior to the collision, and no attempt
                                is made for its final target.
 
+             'rot_Y+Z'     ... Combination of a rotation method 'rot_Y' followed immediately
+                               by an extension or retraction method 'Z', e.g. 'rot_ccw_A+retract_B'.
+                               See pc.combined_adjustment_methods. These are only proposed if
+                               the jogged position passes a quick spatial precheck (see
+                               _combined_adjustment_precheck).
+
           do_not_move ... see comments in adjust_path() docstr
 
         The subscript 'X' in many of the adjustment methods above refers to the
@@ -573,6 +1044,10 @@ class PosScheduleStage(object):
         # one time.) Anyway, worth considering and doing a few timing tests. Really, most
         # time is spent doing collision checks --- that's where the real cost of additional
         # path adjustments has to be considered.
+
+        # The 16 combinations are now generated in pc.combined_adjustment_methods. To limit
+        # their collision checking cost, they're tried only after all single methods fail,
+        # and only if the jogged position passes _combined_adjustment_precheck().
         if self.sweeps[posid].collision_case == pc.case.I: # no collision
             return {}
         if self.sweeps[posid].is_frozen:
@@ -632,6 +1107,10 @@ class PosScheduleStage(object):
             tables[posid].set_prepause(0,neighbor_clearance_time)
             return {posid:tables[posid]} # exclude neighbor here, since nothing being done to it
 
+        # combined rotation + extension / retraction methods
+        if '+' in method:
+            return self._propose_combined_adjustment(posid, method, tables, tables_data, neighbor, neighbor_can_move, neighbor_clearance_time)
+
         # retract, rot, extend, repel methods: calculate jog distances
         max_abs_jog = abs(self._max_jog[method])
         jogs = {} # will hold distance(s) to move away from target and then back toward target
@@ -702,6 +1181,109 @@ class PosScheduleStage(object):
             tables[posid].set_move(new_final_idx, axis, -jogs[posid])
         return tables
 
+    def _propose_combined_adjustment(self, posid, method, tables, tables_data, neighbor, neighbor_can_move, neighbor_clearance_time):
+        """Completes the proposal of _propose_path_adjustment() for a combined method
+        'rot_Y+Z'. The positioner first jogs theta per 'rot_Y', then phi per 'Z', waits
+        for the neighbor to clear, and then retraces its jogs in reverse order. Arguments
+        are as already determined in _propose_path_adjustment().
+
+        Returns {} if either jog is range limited to zero (then the combination is the
+        same as a single method, which has already been tried), if the neighbor finishes
+        moving before the collision time (then retracing the jogs can't change anything),
+        or if the jogged position fails _combined_adjustment_precheck().
+        """
+        posmodel = self.collider.posmodels[posid]
+        rot_method, phi_method = method.split('+')
+        start = tables[posid].init_posintTP
+        T_direction = +1 if 'ccw' in rot_method else -1
+        T_jog = self._range_limited_jog(nominal=abs(self._max_jog[rot_method]), direction=T_direction, start=start[0], limits=posmodel.targetable_range_posintT)
+        P_limits = posmodel.targetable_range_posintP
+        if 'retract' in phi_method:
+            P_limits[1] = min(P_limits[1], self.collider.Ei_phi)
+            P_direction = +1
+        else:
+            P_direction = -1
+        P_jog = self._range_limited_jog(nominal=abs(self._max_jog[phi_method]), direction=P_direction, start=start[1], limits=P_limits)
+        if not T_jog or not P_jog:
+            return {}
+        if neighbor_can_move and tables_data[neighbor]['net_time'][-1] <= self.sweeps[posid].collision_time:
+            passed = False # neighbor was already stationary at the collision, and after retracing the jogs, posid would repeat the same path into it
+        else:
+            passed = self._combined_adjustment_precheck(posid, neighbor, [start[0] + T_jog, start[1] + P_jog], neighbor_clearance_time, retraced=neighbor_can_move)
+        if self.stats.is_enabled():
+            self.stats.add_combined_adjustment_precheck(passed)
+        if not passed:
+            return {}
+        jog_time = 0.0
+        for axis, jog in [(pc.T, T_jog), (pc.P, P_jog)]:
+            jog_time += posmodel.true_move(axisid=axis, distance=jog, allow_cruise=True, limits=None, init_posintTP=None)['move_time']
+        table = tables[posid]
+        if neighbor_can_move:
+            for i in range(4):
+                table.insert_new_row(0)
+            table.set_move(0, pc.T, T_jog)
+            table.set_move(1, pc.P, P_jog)
+            table.set_postpause(1, neighbor_clearance_time)
+            table.set_move(2, pc.P, -P_jog)
+            table.set_move(3, pc.T, -T_jog)
+            if neighbor in tables:
+                tables[neighbor].insert_new_row(0)
+                tables[neighbor].set_prepause(0, jog_time)
+        else:
+            table.insert_new_row(0)
+            table.insert_new_row(0)
+            table.set_move(0, pc.T, T_jog)
+            table.set_move(1, pc.P, P_jog)
+            table.set_move(table.n_rows, pc.P, -P_jog)
+            table.set_move(table.n_rows, pc.T, -T_jog)
+        return tables
+
+    def _combined_adjustment_precheck(self, posid, neighbor, jogged_posintTP, neighbor_clearance_time, retraced=True):
+        """Quick spatial test of whether a combined adjustment could possibly help,
+        before spending any full sweep collision checks on it. The positioner is
+        placed at its intermediate (theta jogged only) and final jogged positions.
+        Returns False if either collides with a fixed boundary, or with the colliding
+        neighbor at its starting position, or if the final jogged position collides
+        with the neighbor at sampled points of its sweep up to neighbor_clearance_time
+        (i.e. while the positioner waits for it to clear). If retraced (i.e. the jogs
+        will be undone before resuming the original path), also returns False if the
+        remainder of that path, after the collision point, runs into the neighbor's
+        final position.
+        """
+        trans = self.collider.posmodels[posid].trans
+        start = self.sweeps[posid].tp_at(0)
+        jogged = trans.posintTP_to_poslocTP(jogged_posintTP)
+        rotated = [jogged[0], start[1]]
+        for poslocTP in (rotated, jogged):
+            if self.collider.spatial_collision_with_fixed(posid, poslocTP) != pc.case.I:
+                return False
+        if neighbor not in self.collider.posmodels:
+            return True
+        if neighbor in self.sweeps:
+            neighbor_sweep = self.sweeps[neighbor]
+            last = neighbor_sweep.step_at_time(neighbor_clearance_time)
+            stride = max(1, last // self._combined_precheck_samples)
+            neighbor_poslocTPs = [neighbor_sweep.tp_at(i) for i in range(0, last, stride)] + [neighbor_sweep.tp_at(last)]
+        else:
+            neighbor_posmodel = self.collider.posmodels[neighbor]
+            neighbor_posintTP = self.start_posintTP.get(neighbor, neighbor_posmodel.expected_current_posintTP)
+            neighbor_poslocTPs = [neighbor_posmodel.trans.posintTP_to_poslocTP(neighbor_posintTP)]
+        if self.collider.spatial_collision_between_positioners(posid, neighbor, rotated, neighbor_poslocTPs[0]) != pc.case.I:
+            return False
+        for neighbor_poslocTP in neighbor_poslocTPs:
+            if self.collider.spatial_collision_between_positioners(posid, neighbor, jogged, neighbor_poslocTP) != pc.case.I:
+                return False
+        if retraced and neighbor in self.sweeps:
+            sweep = self.sweeps[posid]
+            neighbor_final = self.sweeps[neighbor].tp_at(-1)
+            first = sweep.step_at_time(sweep.collision_time)
+            last = len(sweep) - 1
+            stride = max(1, (last - first) // self._combined_precheck_samples)
+            for i in list(range(first, last, stride)) + [last]:
+                if self.collider.spatial_collision_between_positioners(posid, neighbor, sweep.tp_at(i), neighbor_final) != pc.case.I:
+                    return False
+        return True
+
     @staticmethod
     def _range_limited_jog(nominal, direction, start, limits):
         """Returns a range-limited jog distance.
@@ -716,6 +1298,15 @@ class PosScheduleStage(object):
             limited = max(start - nominal, min(limits))
         return limited - start
 
+    def _table_key(self, posid, init_poslocTP, collider_table):
+        """Returns a hashable key uniquely identifying the motion of a positioner
+        through a move table, for use in the collision check caches. Arguments are
+        the table's starting position and for_collider() output.
+        """
+        contents = tuple((k, tuple(v) if isinstance(v, list) else v) for k, v in sorted(collider_table.items()))
+        is_retracted = posid in self.collider.classified_as_retracted # affects the polygons used in checking
+        return (posid, tuple(init_poslocTP), is_retracted, contents)
+
     def _get_or_generate_table(self, posid, should_copy=False):
         """Fetches move table for posid from self.move_tables. If no such table
         exists, generates a new one. The should_copy flag allows you to request
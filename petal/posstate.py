@@ -50,6 +50,7 @@ class PosState(object):
         self.printfunc = printfunc
         self.logging = logging
         self.write_to_DB = False
+        self.revision = 0  # incremented upon every accepted store(), so that dependent caches (e.g. in posmovetable) can detect changes
         self._set_altered_state_adders(func_move=alt_move_adder, func_calib=alt_calib_adder)
         if DB_COMMIT_AVAILABLE and (os.getenv('DOS_POSMOVE_WRITE_TO_DB')
                                     in ['True', 'true', 'T', 't', '1', None]):
@@ -306,6 +307,7 @@ class PosState(object):
         else:
             self._val[key] = val  # set value if all checks above are passed
             # self.printfunc(f'Key {key} set to value: {val}.')  # debug line
+        self.revision += 1
         if register_if_altered:
             if pc.is_calib_key(key):
                 self._register_altered_calib()
@@ -44,6 +44,7 @@ from datetime import datetime
 from typing import Dict, List, Any, Optional, Tuple
 import traceback
 import argparse
+import tempfile
 
 
 def _setup_environment_for_tests():
@@ -119,6 +120,8 @@ import posmodel
 import posstate
 import posmovetable
 import posconstants as pc
+import poscollider
+import xy2tp
 
 
 class RegressionTestSuite:
@@ -152,6 +155,7 @@ class RegressionTestSuite:
         self.petal_id = 0
         self.petal_loc = 3
         self.test_posids = self._get_test_posids()
+        self.crowded_posids = self._get_crowded_posids()
 
     def _get_test_posids(self) -> List[str]:
         """Get list of positioner IDs for testing"""
@@ -165,6 +169,21 @@ class RegressionTestSuite:
         # These correspond to pre-existing static config files in fp_settings_min/pos_settings/
         return [f'M{loc*100+1:05d}' for loc in sorted(test_device_locs)]
 
+    def _get_crowded_posids(self) -> List[List[str]]:
+        """Get two clusters of closely-packed positioner IDs, for tests which need
+        neighbor collisions (the positioners from _get_test_posids() are too far apart
+        to ever hit one another).
+
+        Each cluster is the 10 nearest device locations, at their nominal flat XY
+        positions, around (60, 20) and (300, 150) on the petal. The clusters are many
+        neighbor hops apart, so they never interact during scheduling.
+        """
+        # Use M9XXXX format where XXXX = device_loc
+        # These correspond to static config files in fp_settings_min/pos_settings/
+        cluster_device_locs = [[4, 5, 6, 7, 8, 9, 10, 13, 14, 15],
+                               [367, 368, 388, 389, 390, 409, 410, 411, 412, 433]]
+        return [[f'M9{loc:04d}' for loc in locs] for locs in cluster_device_locs]
+
     # ============================================================
     # TEST SCENARIOS
     # ============================================================
@@ -1091,6 +1110,561 @@ class RegressionTestSuite:
 
         return results
 
+    def test_13_local_replanning(self) -> Dict:
+        """
+        Test local re-planning after a final-stage collision repair.
+
+        A collision surviving the final check is rare, so one is injected on the first
+        pass: its two positioners get dummy targets, and the schedule re-plans only
+        around them (PosSchedule._replan_moves). The same is done with local re-planning
+        turned off, for comparison. In both cases:
+        - Which posids had targets replaced, and how many re-plans were made
+        - Resulting move tables and stage times
+        - A fresh collision check of the final stage finds nothing
+        """
+        results = {}
+        targets = [[35.0, 130.0], [-40.0, 150.0], [150.0, 110.0], [-120.0, 170.0],
+                   [80.0, 140.0], [-10.0, 175.0], [170.0, 125.0]]
+        for label, local in [('local', True), ('full', False)]:
+            ptl = self._create_test_petal(
+                simulator_on=True,
+                anticollision='adjust',
+                sched_stats_on=True,
+            )
+            ptl.request_targets({posid: {'command': 'posintTP',
+                                         'target': target,
+                                         'log_note': f'test_13_{label}'}
+                                 for posid, target in zip(self.test_posids, targets)})
+            schedule = ptl.schedule
+            passes = []
+            combine_and_check = schedule._combine_and_check_final_stage
+            def inject_collision(anticollision, timer_start):
+                colliding, pairs, timer, final = combine_and_check(anticollision, timer_start)
+                passes.append(sorted(pairs))
+                if len(passes) == 1 and not pairs:
+                    moving = sorted(p for p, table in final.move_tables.items() if not table.is_motionless)
+                    posid = moving[0]
+                    neighbor = sorted(n for n in ptl.collider.pos_neighbors[posid] if n in moving)[0]
+                    colliding = {p: final.sweeps[p] for p in (posid, neighbor)}
+                    pairs = {f'{posid}-{neighbor}'}
+                return colliding, pairs, timer, final
+            schedule._combine_and_check_final_stage = inject_collision
+            replanned = []
+            replan_moves = schedule._replan_moves
+            def record_replan(posids, *args):
+                replanned.append(sorted(posids))
+                return replan_moves(posids, *args)
+            schedule._replan_moves = record_replan
+            if not local:
+                schedule._can_replan_locally = lambda anticollision: False
+
+            ptl.schedule_moves(anticollision='adjust')
+            move_tables = self._capture_move_tables(ptl)
+            stage_times = {name: round(max([table.total_time() for table in schedule.stages[name].move_tables.values()] + [0.0]), 6)
+                           for name in schedule.RRE_stage_order + ['final']}
+            final = schedule.stages['final']
+            colliding, _ = final.find_collisions({p: table.copy() for p, table in final.move_tables.items()})
+            dummies = sorted(p for p, request in schedule._requests.items() if request['is_dummy'])
+            ptl.send_and_execute_moves()
+
+            results[label] = {
+                'passes': passes,
+                'replanned_around': replanned,
+                'dummy_requests': dummies,
+                'stage_times': stage_times,
+                'fresh_final_check_colliding': sorted(colliding),
+                'final_state': self._capture_petal_state(ptl, move_tables=move_tables),
+            }
+        return results
+
+    def test_14_xy2tp_batch(self) -> Dict:
+        """
+        Test that xy2tp_batch() is bit-identical to xy2tp() point by point.
+
+        Covers reachable and unreachable points, per-point arm lengths and
+        ranges (some narrow enough to force range failures), and theta guesses
+        given for only some of the points.
+        """
+        rng = np.random.default_rng(14)
+        n = 600
+        xy = rng.uniform(-7.0, 7.0, (2, n))
+        r = np.vstack([rng.uniform(2.5, 3.5, n), rng.uniform(2.5, 3.5, n)])
+        wide = [[-190.0, 190.0], [-5.0, 185.0]]
+        narrow = [[-60.0, 60.0], [100.0, 185.0]]
+        ranges = np.array([narrow if i % 4 == 0 else wide for i in range(n)])
+        t_guess = np.where(np.arange(n) % 3 == 0, np.nan, rng.uniform(-180.0, 180.0, n))
+
+        batch_tp, batch_unreachable = xy2tp.xy2tp_batch(xy, r, ranges, t_guess=t_guess)
+        mismatched = []
+        for i in range(n):
+            guess = None if np.isnan(t_guess[i]) else t_guess[i]
+            tp, unreachable = xy2tp.xy2tp(xy[:, i].tolist(), r[:, i].tolist(), ranges[i].tolist(), t_guess=guess)
+            if tp[0] != batch_tp[0, i] or tp[1] != batch_tp[1, i] or unreachable != batch_unreachable[i]:
+                mismatched.append(i)
+
+        return {
+            'n_points': n,
+            'n_with_guess': int(np.count_nonzero(~np.isnan(t_guess))),
+            'n_unreachable': int(np.count_nonzero(batch_unreachable)),
+            'mismatched_points': mismatched,
+            'first_points_tp': [[float(batch_tp[0, i]), float(batch_tp[1, i])] for i in range(10)],
+        }
+
+    def test_15_schedule_cache(self) -> Dict:
+        """
+        Test the petal's schedule cache (see posschedule.ScheduleCache).
+
+        - Scheduling the same requests again, from the same positions, is a cache hit
+          which reproduces the same move tables
+        - After the moves are executed, the same targets (from new positions) miss
+        """
+        results = {}
+        ptl = self._create_test_petal(
+            simulator_on=True,
+            anticollision='adjust',
+            sched_stats_on=True,
+        )
+        ptl.set_schedule_cache_size(4)
+        targets = [[98.0, 175.0], [-84.0, 167.0], [105.0, 140.0], [-161.0, 115.0],
+                   [43.0, 96.0], [-94.0, 97.0], [-82.0, 155.0]]
+        requests = {posid: {'command': 'posintTP', 'target': target, 'log_note': 'test_15'}
+                    for posid, target in zip(self.test_posids, targets)}
+
+        runs = []
+        for i in range(2):
+            ptl.request_targets({posid: dict(request) for posid, request in requests.items()})
+            ptl.schedule_moves(anticollision='adjust')
+            runs.append({
+                'move_tables': self._capture_move_tables(ptl),
+                'schedule_cache_hit': ptl.schedule_stats.numbers['schedule cache hit'][-1],
+                'cache_info': ptl.get_schedule_cache_info(),
+            })
+            if i == 0:
+                ptl._cancel_move(reset_flags=False)
+        results['first'] = runs[0]
+        results['repeat'] = runs[1]
+        results['repeat_tables_identical'] = runs[0]['move_tables'] == runs[1]['move_tables']
+        ptl.send_and_execute_moves()
+
+        ptl.request_targets({posid: dict(request) for posid, request in requests.items()})
+        ptl.schedule_moves(anticollision='adjust')
+        results['after_moving'] = {
+            'schedule_cache_hit': ptl.schedule_stats.numbers['schedule cache hit'][-1],
+            'cache_info': ptl.get_schedule_cache_info(),
+        }
+        ptl.send_and_execute_moves()
+        results['final_state'] = self._capture_petal_state(ptl)
+        return results
+
+    def test_16_continuous_collision_mode(self) -> Dict:
+        """
+        Test scheduling with the collider's continuous-time collision checking
+        (COLLISION_CHECK_MODE = 'continuous'), alongside the default 'quantized'
+        mode, on the same set of requests. The targets drive M02101 into the
+        petal boundary during its move, so both modes have a collision to find
+        and resolve. For each mode:
+        - Collisions found and how they were resolved
+        - Resulting move tables and final positions
+        """
+        results = {}
+        targets = [[98.0, 175.0], [-84.0, 167.0], [105.0, 140.0], [-161.0, 115.0],
+                   [43.0, 96.0], [-94.0, 97.0], [-82.0, 155.0]]
+        for mode in ['quantized', 'continuous']:
+            ptl = self._create_test_petal(
+                simulator_on=True,
+                anticollision='adjust',
+                sched_stats_on=True,
+            )
+            ptl.collider.check_mode = mode
+            ptl.request_targets({posid: {'command': 'posintTP', 'target': target, 'log_note': f'test_16_{mode}'}
+                                 for posid, target in zip(self.test_posids, targets)})
+            ptl.schedule_moves(anticollision='adjust')
+            move_tables = self._capture_move_tables(ptl)
+            stats = ptl.schedule_stats
+            collisions = stats.collisions[stats.latest]
+            ptl.send_and_execute_moves()
+            results[mode] = {
+                'collisions_found': sorted(collisions['found']),
+                'collisions_resolved': {method: sorted(pairs) for method, pairs in sorted(collisions['resolved'].items())},
+                'final_check_collisions': stats.total_unresolved,
+                'final_state': self._capture_petal_state(ptl, move_tables=move_tables),
+            }
+        return results
+
+    def test_17_pair_lookup_table(self) -> Dict:
+        """
+        Test the pos-pos collision lookup table (poscollider.PosPairLookup) against the
+        exact polygon checks.
+
+        A small table is generated on a coarse grid. Since the test petal's positioners
+        are too far apart to ever touch, two of them are placed one nominal pitch apart
+        in the collider. The table's geometry slack is wide enough to cover their keepouts'
+        deviations from nominal. Random positions of the pair are then checked with the table
+        loaded and without, and any positions where the results differ are listed. (At a
+        grid this coarse, cells are only ever clear or uncertain, so it is the clear
+        answers and the fallback to exact checks which get compared.)
+        """
+        rng = np.random.default_rng(17)
+        ptl = self._create_test_petal(simulator_on=True, anticollision='adjust')
+        collider = ptl.collider
+        posid_A, posid_B = self.test_posids[0], self.test_posids[1]
+        collider.x0[posid_B] = collider.x0[posid_A] + 10.4
+        collider.y0[posid_B] = collider.y0[posid_A]
+        collider.clear_placement_cache()
+
+        header = poscollider.pair_lookup_header(collider.general_keepout_P, collider.general_keepout_T,
+                                                pc.nominals['LENGTH_R1']['value'], d_min=10.0, d_step=0.2,
+                                                n_d=4, t_step=20.0, p_min=-30.0, p_step=10.0, n_p=24,
+                                                geometry_slack=1.0) # covers both test positioners' keepout deviations
+        cells = poscollider.classify_pair_cells(header)
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, 'pospos_test.bin')
+            poscollider.save_pair_lookup(path, header, cells)
+            collider._load_pair_lookup(path)
+            lookup = collider.pair_lookup
+            table_counts = lookup.counts()
+
+            n = 4000
+            positions = np.vstack([rng.uniform(-180.0, 180.0, n), rng.uniform(-20.0, 185.0, n),
+                                   rng.uniform(-180.0, 180.0, n), rng.uniform(-20.0, 185.0, n)]).T.tolist()
+            exact_cases = []
+            mismatched = []
+            collider.pair_lookup_stats(reset=True)
+            for i, (t1, p1, t2, p2) in enumerate(positions):
+                collider.pair_lookup = None
+                exact = collider.spatial_collision_between_positioners(posid_A, posid_B, [t1, p1], [t2, p2])
+                collider.pair_lookup = lookup
+                looked_up = collider.spatial_collision_between_positioners(posid_A, posid_B, [t1, p1], [t2, p2])
+                exact_cases.append(int(exact))
+                if looked_up != exact:
+                    mismatched.append([i, int(exact), int(looked_up)])
+            lookup_stats = collider.pair_lookup_stats()
+            collider._load_pair_lookup('')
+
+        return {
+            'table_cells': table_counts,
+            'n_positions': n,
+            'exact_case_counts': {str(case): exact_cases.count(case) for case in sorted(set(exact_cases))},
+            'lookup_counts': {key: lookup_stats[key] for key in ['clear', 'colliding', 'fallback', 'not applicable']},
+            'mismatched_positions': mismatched,
+        }
+
+    def test_18_fixed_lookup_table(self) -> Dict:
+        """
+        Test the pos-fixed collision lookup table (poscollider.PosFixedLookup) against
+        the exact polygon checks.
+
+        A table is generated for the test positioners' locations. Random positions of
+        those which can reach a fixed keepout are checked with the table loaded and
+        without, and any positions where the results differ are listed. Then a schedule
+        with a collision against the petal boundary (same requests as test_16) is made
+        both ways, and must give the same move tables.
+        """
+        rng = np.random.default_rng(18)
+        targets = [[98.0, 175.0], [-84.0, 167.0], [105.0, 140.0], [-161.0, 115.0],
+                   [43.0, 96.0], [-94.0, 97.0], [-82.0, 155.0]]
+        requests = {posid: {'command': 'posintTP', 'target': target, 'log_note': 'test_18'}
+                    for posid, target in zip(self.test_posids, targets)}
+        results = {}
+        with tempfile.TemporaryDirectory() as tmpdir:
+            path = os.path.join(tmpdir, 'posfixed_test.bin')
+            for use_table in [False, True]:
+                ptl = self._create_test_petal(simulator_on=True, anticollision='adjust', sched_stats_on=True)
+                collider = ptl.collider
+                if use_table:
+                    locations = {collider.posmodels[posid].deviceloc: (collider.x0[posid], collider.y0[posid])
+                                 for posid in self.test_posids}
+                    header = poscollider.fixed_lookup_header(collider.general_keepout_P, collider.keepout_PTL,
+                                                             collider.keepout_GFA, pc.nominals['LENGTH_R1']['value'],
+                                                             locations, t_step=2.0, p_step=2.0, n_p=120)
+                    poscollider.save_pair_lookup(path, header, poscollider.classify_fixed_cells(header))
+                    collider._load_fixed_lookup(path)
+                    results['table_cells'] = collider.fixed_lookup.counts()
+                    results['table_locations'] = [loc for loc, x, y in header['locations']]
+                    lookup = collider.fixed_lookup
+
+                    n = 3000
+                    posids = [posid for posid in self.test_posids if collider.fixed_neighbor_cases[posid]]
+                    exact_cases = []
+                    mismatched = []
+                    for i in range(n):
+                        posid = posids[i % len(posids)]
+                        poslocTP = [float(rng.uniform(-180.0, 180.0)), float(rng.uniform(-20.0, 185.0))]
+                        collider.fixed_lookup = None
+                        exact = collider.spatial_collision_with_fixed(posid, poslocTP)
+                        collider.fixed_lookup = lookup
+                        looked_up = collider.spatial_collision_with_fixed(posid, poslocTP)
+                        exact_cases.append(int(exact))
+                        if looked_up != exact:
+                            mismatched.append([i, int(exact), int(looked_up)])
+                    results['n_positions'] = n
+                    results['exact_case_counts'] = {str(case): exact_cases.count(case) for case in sorted(set(exact_cases))}
+                    results['mismatched_positions'] = mismatched
+                    collider.fixed_lookup_stats(reset=True)
+
+                ptl.request_targets({posid: dict(request) for posid, request in requests.items()})
+                ptl.schedule_moves(anticollision='adjust')
+                label = 'with_table' if use_table else 'without_table'
+                results[label] = {
+                    'move_tables': self._capture_move_tables(ptl),
+                    'collisions_found': sorted(ptl.schedule_stats.collisions[ptl.schedule_stats.latest]['found']),
+                }
+                if use_table:
+                    stats = collider.fixed_lookup_stats()
+                    results[label]['lookup_counts'] = {key: stats[key] for key in ['clear', 'colliding', 'fallback', 'not applicable']}
+                    collider._load_fixed_lookup('')
+        results['schedules_identical'] = results['with_table']['move_tables'] == results['without_table']['move_tables']
+        return results
+
+    def test_19_time_resolution_order(self) -> Dict:
+        """
+        Test collision resolution in order of collision time (COLLISION_RESOLUTION_ORDER
+        = 'time', see PosScheduleStage.adjust_paths_by_time), alongside the default
+        'posid' order, on the same crowded set of requests. The targets for the two
+        clusters of _get_crowded_posids() make several neighbor collisions, which take
+        multiple adjustment passes to resolve. For each order:
+        - Number of adjustment passes and find_collisions calls
+        - Collisions found and how they were resolved
+        - Collisions found by the final check (should be none)
+        - Resulting move tables and final positions
+        """
+        results = {}
+        posids = self.crowded_posids[0] + self.crowded_posids[1]
+        targets = [[47.4, -5.2], [-76.5, 32.4], [80.4, 118.6], [133.3, 6.5], [-26.5, -4.3],
+                   [-95.7, 86.0], [-161.0, 27.8], [51.0, 93.5], [-95.1, 102.0], [105.2, -8.8],
+                   [104.0, 122.6], [-54.3, 19.5], [155.5, 54.0], [-138.5, 8.4], [118.1, 104.7],
+                   [104.4, 128.6], [12.3, 174.9], [-41.3, 94.9], [112.0, 107.5], [123.0, 99.7]]
+        for order in ['posid', 'time']:
+            ptl = self._create_test_petal(
+                simulator_on=True,
+                anticollision='adjust',
+                sched_stats_on=True,
+                posids=posids,
+            )
+            ptl.collider.resolution_order = order
+            ptl.request_targets({posid: {'command': 'posintTP', 'target': target, 'log_note': f'test_19_{order}'}
+                                 for posid, target in zip(posids, targets)})
+            ptl.schedule_moves(anticollision='adjust')
+            move_tables = self._capture_move_tables(ptl)
+            stats = ptl.schedule_stats
+            collisions = stats.collisions[stats.latest]
+            results[order] = {
+                'adjustment_passes': stats.numbers['num path adjustment iters'][-1],
+                'find_collisions_calls': stats.numbers['num find_collisions calls'][-1],
+                'collisions_found': sorted(collisions['found']),
+                'collisions_resolved': {method: sorted(pairs) for method, pairs in sorted(collisions['resolved'].items())},
+                'final_check_collisions': stats.total_unresolved,
+            }
+            ptl.send_and_execute_moves()
+            results[order]['final_state'] = self._capture_petal_state(ptl, move_tables=move_tables)
+        return results
+
+    def test_20_parallel_components(self) -> Dict:
+        """
+        Test collision resolution split into independent conflict components
+        (PARALLEL_COMPONENTS = True, see PosScheduleStage.adjust_paths_by_component),
+        resolved in 4 threads, against the default serial adjust_paths(). The requests
+        (same as test_19) make collisions in both clusters of _get_crowded_posids(),
+        which are further apart than the hops over which adjustments can interact, so
+        each pass resolves them as 2 components.
+        - Components of the crowded posids, and whether the clusters are within 4 hops
+        - Adjustment passes, find_collisions calls, collisions found and resolved
+        - Move tables and stats are identical to serial resolution
+        """
+        results = {}
+        posids = self.crowded_posids[0] + self.crowded_posids[1]
+        targets = [[47.4, -5.2], [-76.5, 32.4], [80.4, 118.6], [133.3, 6.5], [-26.5, -4.3],
+                   [-95.7, 86.0], [-161.0, 27.8], [51.0, 93.5], [-95.1, 102.0], [105.2, -8.8],
+                   [104.0, 122.6], [-54.3, 19.5], [155.5, 54.0], [-138.5, 8.4], [118.1, 104.7],
+                   [104.4, 128.6], [12.3, 174.9], [-41.3, 94.9], [112.0, 107.5], [123.0, 99.7]]
+        for mode in ['serial', 'by_component']:
+            ptl = self._create_test_petal(
+                simulator_on=True,
+                anticollision='adjust',
+                sched_stats_on=True,
+                posids=posids,
+            )
+            if mode == 'by_component':
+                ptl.collider.parallel_components = True
+                ptl.collider.collision_threads = 4
+            ptl.request_targets({posid: {'command': 'posintTP', 'target': target, 'log_note': f'test_20_{mode}'}
+                                 for posid, target in zip(posids, targets)})
+            ptl.schedule_moves(anticollision='adjust')
+            stats = ptl.schedule_stats
+            collisions = stats.collisions[stats.latest]
+            results[mode] = {
+                'move_tables': self._capture_move_tables(ptl),
+                'stats': {key: stats.numbers[key][-1] for key in ['num path adjustment iters', 'num find_collisions calls',
+                                                                  'num neighbor pairs checked', 'num neighbor pairs pruned']},
+                'collisions_found': sorted(collisions['found']),
+                'collisions_resolved': {method: sorted(pairs) for method, pairs in sorted(collisions['resolved'].items())},
+                'final_check_collisions': stats.total_unresolved,
+            }
+        stage = ptl.schedule.stages['extend']
+        results['components'] = stage.conflict_components(posids)
+        results['clusters_within_4_hops'] = bool(stage._hops_from(set(self.crowded_posids[0]), 4) & set(self.crowded_posids[1]))
+        results['tables_identical'] = results['serial']['move_tables'] == results['by_component']['move_tables']
+        results['stats_identical'] = all(results['serial'][key] == results['by_component'][key]
+                                         for key in ['stats', 'collisions_found', 'collisions_resolved', 'final_check_collisions'])
+        return results
+
+    def test_21_planner_anticollision(self) -> Dict:
+        """
+        Test scheduling with anticollision='plan' (see posplanner.PosPlanner), on the
+        crowded requests of test_19. Some positioners get paths with waits or detours,
+        and some get no path and stay put.
+        - Move tables, and which positioners were detoured or not planned
+        - Collisions found by the schedule's final check, and by a fresh
+          find_collisions on the final stage (both should be none)
+        - Final positions after executing the moves
+        """
+        posids = self.crowded_posids[0] + self.crowded_posids[1]
+        targets = [[47.4, -5.2], [-76.5, 32.4], [80.4, 118.6], [133.3, 6.5], [-26.5, -4.3],
+                   [-95.7, 86.0], [-161.0, 27.8], [51.0, 93.5], [-95.1, 102.0], [105.2, -8.8],
+                   [104.0, 122.6], [-54.3, 19.5], [155.5, 54.0], [-138.5, 8.4], [118.1, 104.7],
+                   [104.4, 128.6], [12.3, 174.9], [-41.3, 94.9], [112.0, 107.5], [123.0, 99.7]]
+        ptl = self._create_test_petal(
+            simulator_on=True,
+            anticollision='plan',
+            sched_stats_on=True,
+            posids=posids,
+        )
+        ptl.request_targets({posid: {'command': 'posintTP', 'target': target, 'log_note': 'test_21'}
+                             for posid, target in zip(posids, targets)})
+        ptl.schedule_moves(anticollision='plan')
+        move_tables = self._capture_move_tables(ptl)
+        stats = ptl.schedule_stats
+        final = ptl.schedule.stages['final']
+        colliding_sweeps, _ = final.find_collisions(final.move_tables)
+        results = {
+            'num_detoured': stats.numbers['num pos planned with waits or detours'][-1],
+            'not_planned': sorted(stats.not_planned[stats.latest]),
+            'final_check_collisions': stats.total_unresolved,
+            'fresh_final_stage_collisions': sorted(colliding_sweeps),
+        }
+        ptl.send_and_execute_moves()
+        results['final_state'] = self._capture_petal_state(ptl, move_tables=move_tables)
+        return results
+
+    def test_22_packed_annealing(self) -> Dict:
+        """
+        Test the 'packed' anneal mode alongside 'filled', on the crowded requests of
+        test_19. For each mode:
+        - Each stage's annealed time and peak concurrent motors per power supply
+        - Collisions found by the final check (should be none)
+        - Resulting move tables and final positions
+        Plus whether every 'packed' stage is no longer, and has no higher peaks, than
+        the 'filled' one.
+        """
+        results = {}
+        posids = self.crowded_posids[0] + self.crowded_posids[1]
+        targets = [[47.4, -5.2], [-76.5, 32.4], [80.4, 118.6], [133.3, 6.5], [-26.5, -4.3],
+                   [-95.7, 86.0], [-161.0, 27.8], [51.0, 93.5], [-95.1, 102.0], [105.2, -8.8],
+                   [104.0, 122.6], [-54.3, 19.5], [155.5, 54.0], [-138.5, 8.4], [118.1, 104.7],
+                   [104.4, 128.6], [12.3, 174.9], [-41.3, 94.9], [112.0, 107.5], [123.0, 99.7]]
+        for anneal_mode in ['filled', 'packed']:
+            ptl = self._create_test_petal(
+                simulator_on=True,
+                anticollision='adjust',
+                anneal_mode=anneal_mode,
+                sched_stats_on=True,
+                posids=posids,
+            )
+            ptl.request_targets({posid: {'command': 'posintTP', 'target': target, 'log_note': f'test_22_{anneal_mode}'}
+                                 for posid, target in zip(posids, targets)})
+            ptl.schedule_moves(anticollision='adjust')
+            move_tables = self._capture_move_tables(ptl)
+            stats = ptl.schedule_stats
+            results[anneal_mode] = {
+                'anneal_metrics': stats.anneal_metrics[stats.latest],
+                'final_check_collisions': stats.total_unresolved,
+            }
+            ptl.send_and_execute_moves()
+            results[anneal_mode]['final_state'] = self._capture_petal_state(ptl, move_tables=move_tables)
+        filled = results['filled']['anneal_metrics']
+        packed = results['packed']['anneal_metrics']
+        results['packed_no_longer'] = all(packed[name]['time'] <= filled[name]['time'] for name in filled)
+        results['packed_peaks_within_filled'] = all(packed[name]['peak'][supply] <= filled[name]['peak'][supply]
+                                                    for name in filled for supply in filled[name]['peak'])
+        return results
+
+    def test_23_batch_transforms(self) -> Dict:
+        """
+        Test that Petal.transform() (see posbatchtransforms.PosBatchTransforms) agrees
+        with each positioner's own PosTransforms functions, to within 1e-9, for every
+        pair of coordinate systems. Checked with the stored calibrations, then again
+        with alternate calibration values overriding one positioner's (which does not
+        change its state revision), and again after removing the override.
+        - Max difference, and whether "unreachable" flags match, in each case
+        - Posids reloaded by PosBatchTransforms.refresh() after each change
+        """
+        results = {}
+        ptl = self._create_test_petal(simulator_on=True)
+        coords = ['posintTP', 'poslocTP', 'poslocXY', 'flatXY', 'obsXY', 'QS', 'ptlXY']
+        posintTP_points = [(10.0, 120.0), (-60.0, 150.0), (100.0, 90.0), (170.0, 175.0)]
+        tol = 1e-9
+
+        def compare_all():
+            max_diff = 0.0
+            flags_match = True
+            for cs1 in coords:
+                for cs2 in coords:
+                    if cs1 == cs2 or ptl.posmodels[self.test_posids[0]].trans.construct(cs1, cs2) is None:
+                        continue  # not a supported conversion
+                    coord = []
+                    expected = []
+                    for posid in self.test_posids:
+                        trans = ptl.posmodels[posid].trans
+                        to_cs1 = trans.construct('posintTP', cs1)
+                        func = trans.construct(cs1, cs2)
+                        for tp in posintTP_points:
+                            uv1 = to_cs1(tp) if cs1 != 'posintTP' else tp
+                            uv1 = uv1[0] if isinstance(uv1[1], bool) else uv1
+                            coord.append({'posid': posid, 'uv1': list(uv1)})
+                            expected.append(func(list(uv1)))
+                    for d, exp in zip(ptl.transform(cs1, cs2, coord), expected):
+                        got = d['uv2']
+                        if isinstance(exp[1], (bool, np.bool_)):
+                            flags_match &= bool(got[1]) == bool(exp[1])
+                            got, exp = got[0], exp[0]
+                        max_diff = max(max_diff, float(np.max(np.abs(np.subtract(got, exp)))))
+            return {'within_tol': max_diff <= tol, 'unreachable_flags_match': flags_match}
+
+        results['stored_calibrations'] = compare_all()
+        results['stored_calibrations']['reloaded'] = sorted(ptl.batch_trans.refresh())
+
+        trans = ptl.posmodels[self.test_posids[0]].trans
+        trans.alt.update({'LENGTH_R1': 3.5, 'LENGTH_R2': 2.8, 'OFFSET_T': -90.0, 'OFFSET_P': 5.0,
+                          'OFFSET_X': trans.getval('OFFSET_X') + 0.5, 'OFFSET_Y': trans.getval('OFFSET_Y') - 0.5})
+        trans.alt_override = True
+        results['alt_override_on'] = {'reloaded': sorted(ptl.batch_trans.refresh())}
+        results['alt_override_on'].update(compare_all())
+
+        trans.alt_override = False
+        results['alt_override_off'] = {'reloaded': sorted(ptl.batch_trans.refresh())}
+        results['alt_override_off'].update(compare_all())
+        return results
+
+    def test_24_focal_surface_lookups(self) -> Dict:
+        """
+        Test the focal surface lookups in posconstants (see pc.FocalSurfaceLookup)
+        against chained np.interp of the lookup table, over each input's range and
+        every knot (see pc.focal_surface_lookup_errors). For each lookup:
+        - Single-table lookups (e.g. R2S) are bit-identical to np.interp
+        - Fused composites (e.g. N2S) are within 1e-12 of the chained lookups
+        - Python float inputs give the same results as arrays
+        """
+        results = {}
+        tol = 1e-12
+        for name, errors in pc.focal_surface_lookup_errors().items():
+            fused = name in {'S2N', 'S2Z', 'Z2S', 'N2S'}
+            results[name] = {
+                'fused': fused,
+                'within_tol': errors['max abs err'] <= tol if fused else errors['exact frac'] == 1.0,
+                'scalar_equals_array': errors['scalar==array'],
+            }
+        return results
+
     # ============================================================
     # HELPER METHODS - PETAL CREATION & STATE CAPTURE
     # ============================================================
@@ -9,11 +9,14 @@ instrument code:
 
 This module generally works with python lists and the math module, rather
 numpy arrays. That is done for speed, since numpy carries tremendous overhead
-in the small, atomic operations done when operating the instrument.
+in the small, atomic operations done when operating the instrument. The one
+exception is xy2tp_batch(), for converting many points at once.
 """
 
 import math
 import sys
+import itertools
+import numpy as np
 try:
     import posconstants as pc
     default_t_guess_tol = pc.default_t_guess_tol
@@ -132,6 +135,114 @@ def xy2tp(xy, r, ranges, t_guess=None, t_guess_tol=default_t_guess_tol):
     unreachable |= range_fail
     return tuple(TP), unreachable
 
+def xy2tp_batch(xy, r, ranges, t_guess=None, t_guess_tol=default_t_guess_tol):
+    """Array version of xy2tp(), converting N points at once. Results are
+    bit-identical to calling xy2tp() on each point individually.
+
+    INPUTS:   xy ... 2xN array of [x,y]
+               r ... 2xN array of [central arm length, eccentric arm length],
+                     or a single pair used for all points
+          ranges ... Nx2x2 array of [[min(theta), max(theta)], [min(phi), max(phi)]],
+                     or a single 2x2 used for all points
+         t_guess ... optional length N array of theta guesses, unit degrees, with
+                     nan where there is no guess (or a single value for all points)
+     t_guess_tol ... see xy2tp()
+
+    OUTPUTS:  tp ... 2xN array of [theta,phi], unit degrees
+     unreachable ... length N boolean array, see xy2tp()
+
+    Steps and selection rules are the same as in xy2tp(), done with arrays. The
+    transcendental functions are evaluated with the math module (see _libm), so
+    that last-bit differences in numpy's own vectorized loops cannot creep in.
+    """
+    numeric_contraction = epsilon*10
+    x, y = np.array(xy, dtype=float).reshape(2, -1)
+    n = x.size
+    r1, r2 = np.broadcast_to(np.array(r, dtype=float).reshape(2, -1), (2, n))
+    ranges = np.broadcast_to(np.array(ranges, dtype=float).reshape(-1, 2, 2), (n, 2, 2))
+    range_min, range_max = ranges.min(axis=2), ranges.max(axis=2)
+
+    # adjust targets within reachable annulus
+    hypot = _pow(_pow(x, 2.0) + _pow(y, 2.0), 0.5)
+    angle = _libm(math.atan2, y, x)
+    outer = r1 + r2
+    inner = np.abs(r1 - r2)
+    unreachable = (hypot > outer) | (hypot < inner)
+    inner = inner + numeric_contraction
+    outer = outer - numeric_contraction
+    HYPOT = np.where(hypot >= outer, outer, np.where(hypot <= inner, inner, hypot))
+    X = HYPOT*_libm(math.cos, angle)
+    Y = HYPOT*_libm(math.sin, angle)
+
+    # transform from cartesian XY to angles TP
+    arccos_arg = (_pow(X, 2.0) + _pow(Y, 2.0) - (_pow(r1, 2.0) + _pow(r2, 2.0))) / (2.0 * r1 * r2)
+    arccos_arg = np.minimum(np.maximum(arccos_arg, -1.0), 1.0)
+    P = _libm(math.acos, arccos_arg)
+    T = angle - _libm(math.atan2, r2*_libm(math.sin, P), r1 + r2*_libm(math.cos, P))
+
+    # primary configuration of the arms
+    TP = np.vstack([np.degrees(T), np.degrees(P)])
+    TP, range_fail = _wrap_TP_into_ranges_batch(TP, range_min, range_max)
+
+    # test alternate configurations, only for points which have a guess
+    g = np.array([], dtype=int) if t_guess is None else \
+        np.flatnonzero(~np.isnan(np.broadcast_to(np.array(t_guess, dtype=float), (n,))))
+    if g.size:
+        guess = np.broadcast_to(np.array(t_guess, dtype=float), (n,))[g]
+        r1g, Xg, Yg, Tg = r1[g], X[g], Y[g], T[g]
+        gmin, gmax = range_min[g], range_max[g]
+        options = [(TP[:, g], range_fail[g], np.ones(g.size, dtype=bool))]
+
+        # reflecting the arms across vector (X,Y)
+        tx = r1g*_libm(math.cos, Tg)
+        ty = r1g*_libm(math.sin, Tg)
+        m = Yg/Xg
+        m_sq = _pow(m, 2.0)
+        tx_alt = ((1 - m_sq)*tx + 2*m*ty)/(m_sq + 1)
+        ty_alt = ((m_sq - 1)*ty + 2*m*tx)/(m_sq + 1)
+        px_alt = Xg - tx_alt
+        py_alt = Yg - ty_alt
+        T_alt = _libm(math.atan2, ty_alt, tx_alt)
+        P_alt = _libm(math.atan2, py_alt, px_alt) - T_alt
+        TP_alt = np.vstack([np.degrees(T_alt), np.degrees(P_alt)])
+        TP_alt, range_fail_alt = _wrap_TP_into_ranges_batch(TP_alt, gmin, gmax)
+        options.append((TP_alt, range_fail_alt, options[0][2]))
+
+        # rotating theta by +/-360 deg, where the base config achieves xy
+        for center_TP, center_fail, _ in options.copy():
+            for wrap in [-360.0, 360.0]:
+                TP_wrap = np.vstack([center_TP[0] + wrap, center_TP[1]])
+                TP_wrap, range_fail_wrap = _wrap_TP_into_ranges_batch(TP_wrap, gmin, gmax)
+                options.append((TP_wrap, range_fail_wrap, ~center_fail))
+
+        # selection, same ordering as the stable sorts in xy2tp()
+        all_closeness_fail = np.ones(g.size, dtype=bool)
+        all_range_fail = np.ones(g.size, dtype=bool)
+        best_TP, best_range_fail = options[0][0].copy(), options[0][1].copy()
+        best_closeness_fail, best_closeness = None, None
+        for opt_TP, opt_range_fail, valid in options:
+            closeness = np.abs(opt_TP[0] - guess)
+            closeness_fail = closeness > t_guess_tol
+            all_closeness_fail &= closeness_fail | ~valid
+            all_range_fail &= opt_range_fail | ~valid
+            if best_closeness is None:
+                best_closeness_fail, best_closeness = closeness_fail, closeness
+                continue
+            better = valid & ((opt_range_fail < best_range_fail) |
+                              ((opt_range_fail == best_range_fail) &
+                               ((closeness_fail < best_closeness_fail) |
+                                ((closeness_fail == best_closeness_fail) & (closeness < best_closeness)))))
+            best_TP[:, better] = opt_TP[:, better]
+            best_range_fail[better] = opt_range_fail[better]
+            best_closeness_fail = np.where(better, closeness_fail, best_closeness_fail)
+            best_closeness = np.where(better, closeness, best_closeness)
+        select = ~(all_closeness_fail | all_range_fail)
+        TP[:, g[select]] = best_TP[:, select]
+        range_fail[g[select]] = best_range_fail[select]
+
+    unreachable |= range_fail
+    return TP, unreachable
+
 def _wrap_TP_into_ranges(tp, ranges):
     '''Call _wrap_into_range for theta and phi angles.
 
@@ -173,3 +284,38 @@ def _wrap_into_range(angle, range_min, range_max):
             new = range_max
             unreachable = True
     return new, unreachable
+
+def _wrap_TP_into_ranges_batch(tp, range_min, range_max):
+    '''Array version of _wrap_TP_into_ranges(), for 2xN tp with Nx2 range_min
+    and range_max. Returns (2xN TP, length N boolean unreachable).
+    '''
+    TP = np.empty_like(tp)
+    unreachable = np.zeros(tp.shape[1], dtype=bool)
+    for i in [0, 1]:
+        TP[i], range_fail = _wrap_into_range_batch(tp[i], range_min[:, i], range_max[:, i])
+        unreachable |= range_fail
+    return TP, unreachable
+
+def _wrap_into_range_batch(angle, range_min, range_max):
+    '''Array version of _wrap_into_range().'''
+    below = angle < range_min
+    above = angle > range_max
+    raised = angle + np.floor((range_max - angle)/360.0)*360.0
+    lowered = angle - np.floor((angle - range_min)/360.0)*360.0
+    raise_fail = below & (raised < range_min)
+    lower_fail = above & (lowered > range_max)
+    new = np.where(below, np.where(raise_fail, range_min, raised),
+                   np.where(above, np.where(lower_fail, range_max, lowered), angle))
+    unreachable = raise_fail | lower_fail
+    return new, unreachable
+
+def _libm(func, *args):
+    '''Evaluates math module func elementwise over 1D float arrays. numpy's
+    vectorized transcendental loops (which may use SIMD approximations) can
+    differ from the C library by an ulp, whereas this matches xy2tp() exactly.
+    '''
+    return np.fromiter(map(func, *(np.asarray(a).tolist() for a in args)), dtype=float, count=np.size(args[0]))
+
+def _pow(a, exponent):
+    '''Elementwise a**exponent, with the same C library pow as python floats.'''
+    return np.fromiter(map(pow, a.tolist(), itertools.repeat(exponent)), dtype=float, count=a.size)